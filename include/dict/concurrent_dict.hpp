@@ -0,0 +1,262 @@
+#ifndef DICT_CONCURRENT_DICT_HPP
+#define DICT_CONCURRENT_DICT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dict.hpp"
+#include "pool_allocator.hpp"
+#include "detail/cache_aligned_allocator.hpp"
+#include "detail/shared_spin_mutex.hpp"
+
+namespace io {
+
+namespace detail {
+
+template <typename Allocator>
+struct is_pool_allocator : std::false_type {};
+
+template <typename T>
+struct is_pool_allocator<pool_allocator<T>> : std::true_type {};
+
+} // namespace detail
+
+// A thread safe map made of a power of two number of dicts (shards), each
+// guarded by its own reader/writer lock. The shard is picked by a Fibonacci
+// multiply-shift of the hash which the dicts in turn get passed as a
+// prehashed key.
+//
+// No references to elements are handed out, values are copied out or only
+// accessed from within a callback which runs while the shard is locked.
+// Callbacks must not call back into the same concurrent_dict.
+//
+// Every shard gets a copy of the allocator and shards are written to
+// concurrently, so an allocator whose copies share state has to be thread
+// safe. io::pool_allocator isn't and is rejected.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>,
+          typename Storage = inline_flag_storage>
+class concurrent_dict {
+public:
+    using dict_type = dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>;
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = typename dict_type::value_type;
+    using size_type = typename dict_type::size_type;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+
+    static_assert(!detail::is_pool_allocator<Allocator>::value,
+                  "the shards would share pools which aren't thread safe");
+
+    concurrent_dict() : concurrent_dict(default_shard_count()) {}
+
+    explicit concurrent_dict(size_type shard_count,
+                             const Hasher& hash = Hasher(),
+                             const KeyEqual& key_equal = KeyEqual(),
+                             const Allocator& alloc = Allocator())
+        : _shard_bits(shard_bits(shard_count)), _hasher(hash) {
+        _shards.reserve(size_type(1) << _shard_bits);
+        for (size_type i = 0; i != size_type(1) << _shard_bits; ++i) {
+            _shards.emplace_back(hash, key_equal, alloc);
+        }
+    }
+
+    concurrent_dict(const concurrent_dict&) = delete;
+    concurrent_dict& operator=(const concurrent_dict&) = delete;
+
+    size_type shard_count() const noexcept { return _shards.size(); }
+
+    // the sum over all shards, only exact if no writer is active
+    size_type size() const {
+        size_type size = 0;
+        for (const auto& shard : _shards) {
+            detail::shared_lock_guard<mutex_type> lock(shard.mutex);
+            size += shard.dict.size();
+        }
+
+        return size;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    void clear() {
+        for (auto& shard : _shards) {
+            std::lock_guard<mutex_type> lock(shard.mutex);
+            shard.dict.clear();
+        }
+    }
+
+    // spreads new_size evenly over the shards
+    void reserve(size_type new_size) {
+        for (auto& shard : _shards) {
+            std::lock_guard<mutex_type> lock(shard.mutex);
+            shard.dict.reserve(new_size >> _shard_bits);
+        }
+    }
+
+    // copies the mapped value of key into value if it's in the dict
+    bool find(const Key& key, Value& value) const {
+        return cvisit(key, [&](const value_type& element) {
+            value = element.second;
+        });
+    }
+
+    bool contains(const Key& key) const {
+        auto hash = _hasher(key);
+        const auto& shard = shard_for(hash);
+
+        detail::shared_lock_guard<mutex_type> lock(shard.mutex);
+        return shard.dict.find(hashed_key<Key>(key, hash)) != shard.dict.end();
+    }
+
+    // returns whether the element was inserted
+    template <typename... Args>
+    bool try_emplace(const Key& key, Args&&... args) {
+        auto hash = _hasher(key);
+        auto& shard = shard_for(hash);
+
+        std::lock_guard<mutex_type> lock(shard.mutex);
+        return shard.dict
+            .try_emplace(hashed_key<Key>(key, hash),
+                         std::forward<Args>(args)...)
+            .second;
+    }
+
+    // returns whether the element was inserted rather than assigned
+    template <typename Mapped>
+    bool insert_or_assign(const Key& key, Mapped&& mapped) {
+        auto hash = _hasher(key);
+        auto& shard = shard_for(hash);
+
+        std::lock_guard<mutex_type> lock(shard.mutex);
+        return shard.dict
+            .insert_or_assign(hashed_key<Key>(key, hash),
+                              std::forward<Mapped>(mapped))
+            .second;
+    }
+
+    size_type erase(const Key& key) {
+        auto hash = _hasher(key);
+        auto& shard = shard_for(hash);
+
+        std::lock_guard<mutex_type> lock(shard.mutex);
+        return shard.dict.erase(hashed_key<Key>(key, hash));
+    }
+
+    // Calls fn with the element of key while its shard is locked exclusively
+    // so fn may modify the mapped value. Returns whether key was found.
+    template <typename Fn>
+    bool visit(const Key& key, Fn fn) {
+        auto hash = _hasher(key);
+        auto& shard = shard_for(hash);
+
+        std::lock_guard<mutex_type> lock(shard.mutex);
+        auto iter = shard.dict.find(hashed_key<Key>(key, hash));
+        if (iter == shard.dict.end()) {
+            return false;
+        }
+
+        fn(*iter);
+        return true;
+    }
+
+    template <typename Fn>
+    bool visit(const Key& key, Fn fn) const {
+        return cvisit(key, fn);
+    }
+
+    // like visit but with a shared lock and a const element
+    template <typename Fn>
+    bool cvisit(const Key& key, Fn fn) const {
+        auto hash = _hasher(key);
+        const auto& shard = shard_for(hash);
+
+        detail::shared_lock_guard<mutex_type> lock(shard.mutex);
+        auto iter = shard.dict.find(hashed_key<Key>(key, hash));
+        if (iter == shard.dict.end()) {
+            return false;
+        }
+
+        fn(*iter);
+        return true;
+    }
+
+    // calls fn for every element, locking one shard at a time
+    template <typename Fn>
+    void cvisit_all(Fn fn) const {
+        for (const auto& shard : _shards) {
+            detail::shared_lock_guard<mutex_type> lock(shard.mutex);
+            for (const auto& element : shard.dict) {
+                fn(element);
+            }
+        }
+    }
+
+private:
+    using mutex_type = detail::shared_spin_mutex;
+
+    struct shard {
+        shard(const Hasher& hash, const KeyEqual& key_equal,
+              const Allocator& alloc)
+            : mutex(), dict(8, hash, key_equal, alloc) {}
+
+        // only moved while the vector is filled in the constructor
+        shard(shard&& other)
+            : mutex(), dict(std::move(other.dict)) {}
+
+        // keeps the locks of neighbouring shards off the same cache line,
+        // which takes the cache aligned allocator of _shards as well
+        alignas(detail::cache_line_bytes()) mutable mutex_type mutex;
+        dict_type dict;
+    };
+
+    const shard& shard_for(std::size_t hash) const {
+        return _shards[shard_index(hash)];
+    }
+
+    shard& shard_for(std::size_t hash) {
+        return _shards[shard_index(hash)];
+    }
+
+    // Fibonacci hashing: multiplies by 2^64 divided by the golden ratio and
+    // takes the top bits of the product, which every bit of the hash feeds
+    // into. Identity hashes spread over the shards too, and the dicts
+    // themselves only look at the low bits of the hash.
+    size_type shard_index(std::size_t hash) const {
+        if (!_shard_bits) {
+            return 0;
+        }
+
+        return std::uint64_t(hash * 0x9e3779b97f4a7c15ull) >>
+               (64 - _shard_bits);
+    }
+
+    static unsigned shard_bits(size_type shard_count) {
+        unsigned bits = 0;
+        while ((size_type(1) << bits) < shard_count) {
+            ++bits;
+        }
+
+        return bits;
+    }
+
+    static size_type default_shard_count() {
+        return 4 * std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<shard, detail::cache_aligned_allocator<shard>> _shards;
+    unsigned _shard_bits;
+    hasher _hasher;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,347 @@
+#ifndef DICT_BITMAP_TABLE_HPP
+#define DICT_BITMAP_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "entry.hpp"
+#include "math_util.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Linear probing with occupancy kept in a packed bitmap beside the entries,
+// so a slot is exactly as big as the entry and iteration can skip 64 empty
+// slots per word.
+template <typename Entry, typename Allocator>
+class bitmap_table {
+    using word_type = std::uint64_t;
+    using entry_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<raw_entry<Entry>>;
+    using word_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<word_type>;
+    using entry_vector = std::vector<raw_entry<Entry>, entry_allocator>;
+    using word_vector = std::vector<word_type, word_allocator>;
+
+    static constexpr std::size_t word_bits() { return 64; }
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename entry_vector::size_type;
+    using difference_type = typename entry_vector::difference_type;
+    using allocator_type = entry_allocator;
+
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename entry_vector::size_type;
+
+        view() : _entries(nullptr), _used(nullptr), _size(0) {}
+
+        view(const Entry* entries, const word_type* used, size_type size)
+            : _entries(entries), _used(used), _size(size) {}
+
+        view(const void* const* arrays, const std::size_t* bytes,
+             size_type size)
+            : view(static_cast<const Entry*>(arrays[0]),
+                   static_cast<const word_type*>(arrays[1]), size) {
+            if (bytes[0] != size * sizeof(Entry) ||
+                bytes[1] != word_count(size) * sizeof(word_type)) {
+                throw std::runtime_error("Table arrays don't match its size");
+            }
+        }
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _entries; }
+
+        bool used(size_type index) const {
+            return (_used[index / word_bits()] >> (index % word_bits())) & 1;
+        }
+
+        const Entry& operator[](size_type index) const {
+            return _entries[index];
+        }
+
+        template <typename K, typename KeyEqual>
+        std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                        const KeyEqual& key_equal) const {
+            auto index = hash & (_size - 1);
+
+            while (used(index)) {
+                if (_entries[index].equals(key, hash, key_equal)) {
+                    return { index, true };
+                }
+
+                index = (index + 1) & (_size - 1);
+            }
+
+            return { index, false };
+        }
+
+        void prefetch(std::size_t hash) const {
+            auto index = hash & (_size - 1);
+            detail::prefetch(&_used[index / word_bits()]);
+            detail::prefetch(&_entries[index]);
+        }
+
+        size_type next_used(size_type index) const {
+            if (index >= _size) {
+                return _size;
+            }
+
+            auto word = index / word_bits();
+            // mask out the bits below index in the first word
+            auto bits = _used[word] & (~word_type(0) << (index % word_bits()));
+
+            while (!bits) {
+                if (++word == word_count(_size)) {
+                    return _size;
+                }
+
+                bits = _used[word];
+            }
+
+            return word * word_bits() + count_trailing_zeros(bits);
+        }
+
+    private:
+        const Entry* _entries;
+        const word_type* _used;
+        size_type _size;
+    };
+
+    static constexpr std::uint32_t layout() { return 3; }
+
+    explicit bitmap_table(const Allocator& alloc)
+        : _entries(entry_allocator(alloc)), _used(word_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    bitmap_table(const bitmap_table& other)
+        : bitmap_table(std::allocator_traits<entry_allocator>::
+                           select_on_container_copy_construction(
+                               other.get_allocator())) {
+        copy_entries(other);
+    }
+
+    bitmap_table(bitmap_table&& other) noexcept = default;
+
+    bitmap_table& operator=(const bitmap_table& other) {
+        if (this != &other) {
+            clear();
+            copy_assign_allocator(_entries, other._entries);
+            copy_assign_allocator(_used, other._used);
+            copy_entries(other);
+        }
+        return *this;
+    }
+
+    bitmap_table& operator=(bitmap_table&& other) noexcept(
+        always_takes_arrays<entry_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(get_allocator(), other.get_allocator())) {
+                _entries = std::move(other._entries);
+                _used = std::move(other._used);
+            } else {
+                move_entries(other);
+            }
+        }
+        return *this;
+    }
+
+    ~bitmap_table() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _entries[index].destroy();
+            }
+        }
+    }
+
+    allocator_type get_allocator() const { return _entries.get_allocator(); }
+
+    size_type size() const noexcept { return _entries.size(); }
+
+    void resize(size_type new_size) {
+        _entries.resize(new_size);
+        _used.assign(word_count(new_size), 0);
+    }
+
+    // destroys the used entries only and resets the bitmap a word at a time
+    void clear() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            _entries[index].destroy();
+        }
+        _used.assign(_used.size(), 0);
+    }
+
+    void swap(bitmap_table& other) {
+        _entries.swap(other._entries);
+        _used.swap(other._used);
+    }
+
+    bool used(size_type index) const {
+        return (_used[index / word_bits()] >> (index % word_bits())) & 1;
+    }
+
+    Entry& operator[](size_type index) { return _entries[index].get(); }
+
+    const Entry& operator[](size_type index) const {
+        return _entries[index].get();
+    }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return as_view().find(key, hash, key_equal);
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        auto index = hash & (size() - 1);
+
+        while (used(index)) {
+            index = next_index(index);
+        }
+
+        return index;
+    }
+
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        _entries[index].construct(std::forward<E>(entry));
+        _entries[index].get().store_hash(hash);
+        set_used(index);
+    }
+
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        for (auto index = hash & (size() - 1); index < end; ++index) {
+            if (!used(index)) {
+                construct(index, hash, std::forward<E>(entry));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy(size_type index) {
+        _entries[index].destroy();
+        clear_used(index);
+    }
+
+    taken_entry<Entry> take(size_type index) {
+        return std::move_if_noexcept((*this)[index]);
+    }
+
+    void relocate(size_type from, size_type to) {
+        _entries[to].construct(std::move(_entries[from].get()));
+        set_used(to);
+        destroy(from);
+    }
+
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& hasher) const {
+        return _entries[index].get().hash(hasher) & (size() - 1);
+    }
+
+    void prefetch(std::size_t hash) const { as_view().prefetch(hash); }
+
+    view as_view() const {
+        return view(entries(), _used.data(), _entries.size());
+    }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    std::size_t allocated_bytes() const {
+        return _entries.size() * sizeof(raw_entry<Entry>) +
+               _used.size() * sizeof(word_type);
+    }
+
+    template <typename Fn>
+    void for_each_array(Fn fn) const {
+        fn(static_cast<const void*>(_entries.data()),
+           _entries.size() * sizeof(Entry));
+        fn(static_cast<const void*>(_used.data()),
+           _used.size() * sizeof(word_type));
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the entries
+    // of other
+    void copy_entries(const bitmap_table& other) {
+        if (trivially_copyable_entry<Entry>::value) {
+            _entries.assign(other._entries.begin(), other._entries.end());
+            _used.assign(other._used.begin(), other._used.end());
+            return;
+        }
+
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(other[index]);
+            set_used(index);
+        }
+    }
+
+    void move_entries(bitmap_table& other) {
+        _entries.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(std::move(other[index]));
+            set_used(index);
+        }
+    }
+
+    static std::size_t word_count(std::size_t size) {
+        return (size + word_bits() - 1) / word_bits();
+    }
+
+
+    // views see the raw entries as the entries they hold
+    const Entry* entries() const {
+        static_assert(sizeof(raw_entry<Entry>) == sizeof(Entry),
+                      "raw entries have to be laid out as entries");
+        return reinterpret_cast<const Entry*>(_entries.data());
+    }
+
+    void set_used(size_type index) {
+        _used[index / word_bits()] |= word_type(1) << (index % word_bits());
+    }
+
+    void clear_used(size_type index) {
+        _used[index / word_bits()] &= ~(word_type(1) << (index % word_bits()));
+    }
+
+    size_type next_index(size_type index) const {
+        return (index + 1) & (size() - 1);
+    }
+
+    entry_vector _entries;
+    word_vector _used;
+};
+
+} // namespace detail
+
+// occupancy in a packed bitmap, entries carry no flag at all
+struct bitmap_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::bitmap_table<Entry, Allocator>;
+};
+
+} // namespace io
+
+#endif
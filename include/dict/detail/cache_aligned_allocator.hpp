@@ -0,0 +1,69 @@
+#ifndef DICT_CACHE_ALIGNED_ALLOCATOR_HPP
+#define DICT_CACHE_ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace io {
+
+namespace detail {
+
+// the cache line size of x86-64 and of most aarch64 cores
+constexpr std::size_t cache_line_bytes() { return 64; }
+
+// Hands out arrays starting on a cache line. Before C++17 std::allocator
+// ignores alignments above that of std::max_align_t, so an array of types
+// declared alignas(cache_line_bytes()) to keep them on cache lines of their
+// own has to come from here. Allocates a cache line more than asked for and
+// keeps the pointer operator new returned right before the array, the gap
+// is at least as big as the alignment of operator new.
+template <typename T>
+class cache_aligned_allocator {
+    static_assert(alignof(T) <= cache_line_bytes(),
+                  "types aligned beyond a cache line aren't supported");
+
+public:
+    using value_type = T;
+
+    cache_aligned_allocator() noexcept = default;
+
+    template <typename U>
+    cache_aligned_allocator(const cache_aligned_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n > (std::numeric_limits<std::size_t>::max() - cache_line_bytes()) /
+                    sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        auto block = static_cast<char*>(
+            ::operator new(n * sizeof(T) + cache_line_bytes()));
+        auto data = block + cache_line_bytes() -
+                    reinterpret_cast<std::uintptr_t>(block) %
+                        cache_line_bytes();
+        reinterpret_cast<void**>(data)[-1] = block;
+        return reinterpret_cast<T*>(data);
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+
+    template <typename U>
+    bool operator==(const cache_aligned_allocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const cache_aligned_allocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+} // namespace detail
+
+} // namespace io
+
+#endif
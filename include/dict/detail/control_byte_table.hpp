@@ -0,0 +1,307 @@
+#ifndef DICT_CONTROL_BYTE_TABLE_HPP
+#define DICT_CONTROL_BYTE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "group.hpp"
+#include "entry.hpp"
+#include "math_util.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Linear probing over a separate array of control bytes. Probing loads a whole
+// group of control bytes at once and only compares keys of slots whose
+// fingerprint matches, so a probe sequence rarely touches the entries at all.
+//
+// The first width() - 1 control bytes are mirrored behind the end of the
+// array so that a group starting at any slot can be loaded without wrapping.
+template <typename Entry, typename Allocator>
+class control_byte_table {
+    using entry_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<raw_entry<Entry>>;
+    using ctrl_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<ctrl_t>;
+    using entry_vector = std::vector<raw_entry<Entry>, entry_allocator>;
+    using ctrl_vector = std::vector<ctrl_t, ctrl_allocator>;
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename entry_vector::size_type;
+    using difference_type = typename entry_vector::difference_type;
+    using allocator_type = entry_allocator;
+
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename entry_vector::size_type;
+
+        view() : _entries(nullptr), _ctrl(nullptr), _size(0) {}
+
+        view(const Entry* entries, const ctrl_t* ctrl, size_type size)
+            : _entries(entries), _ctrl(ctrl), _size(size) {}
+
+        // a file written with wider groups has more mirrored bytes than we
+        // need, narrower ones too few
+        view(const void* const* arrays, const std::size_t* bytes,
+             size_type size)
+            : view(static_cast<const Entry*>(arrays[0]),
+                   static_cast<const ctrl_t*>(arrays[1]), size) {
+            if (bytes[0] != size * sizeof(Entry) ||
+                bytes[1] < size + ctrl_group::width() - 1) {
+                throw std::runtime_error("Table arrays don't match its size");
+            }
+        }
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _entries; }
+
+        bool used(size_type index) const { return _ctrl[index] >= 0; }
+
+        const Entry& operator[](size_type index) const {
+            return _entries[index];
+        }
+
+        template <typename K, typename KeyEqual>
+        std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                        const KeyEqual& key_equal) const {
+            return probe_ctrl(_ctrl, _size, hash, [&](size_type index) {
+                return _entries[index].equals(key, hash, key_equal);
+            });
+        }
+
+        void prefetch(std::size_t hash) const {
+            auto index = hash & (_size - 1);
+            detail::prefetch(&_ctrl[index]);
+            detail::prefetch(&_entries[index]);
+        }
+
+        size_type next_used(size_type index) const {
+            return next_used_ctrl(_ctrl, _size, index);
+        }
+
+    private:
+        const Entry* _entries;
+        const ctrl_t* _ctrl;
+        size_type _size;
+    };
+
+    static constexpr std::uint32_t layout() { return 2; }
+
+    explicit control_byte_table(const Allocator& alloc)
+        : _entries(entry_allocator(alloc)), _ctrl(ctrl_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    control_byte_table(const control_byte_table& other)
+        : control_byte_table(std::allocator_traits<entry_allocator>::
+                                 select_on_container_copy_construction(
+                                     other.get_allocator())) {
+        copy_entries(other);
+    }
+
+    control_byte_table(control_byte_table&& other) noexcept = default;
+
+    control_byte_table& operator=(const control_byte_table& other) {
+        if (this != &other) {
+            clear();
+            copy_assign_allocator(_entries, other._entries);
+            copy_assign_allocator(_ctrl, other._ctrl);
+            copy_entries(other);
+        }
+        return *this;
+    }
+
+    control_byte_table& operator=(control_byte_table&& other) noexcept(
+        always_takes_arrays<entry_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(get_allocator(), other.get_allocator())) {
+                _entries = std::move(other._entries);
+                _ctrl = std::move(other._ctrl);
+            } else {
+                move_entries(other);
+            }
+        }
+        return *this;
+    }
+
+    ~control_byte_table() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _entries[index].destroy();
+            }
+        }
+    }
+
+    allocator_type get_allocator() const { return _entries.get_allocator(); }
+
+    size_type size() const noexcept { return _entries.size(); }
+
+    void resize(size_type new_size) {
+        _entries.resize(new_size);
+        _ctrl.assign(new_size + ctrl_group::width() - 1, ctrl_empty);
+    }
+
+    // destroys the used entries only and resets all control bytes at once
+    void clear() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            _entries[index].destroy();
+        }
+        _ctrl.assign(_ctrl.size(), ctrl_empty);
+    }
+
+    void swap(control_byte_table& other) {
+        _entries.swap(other._entries);
+        _ctrl.swap(other._ctrl);
+    }
+
+    bool used(size_type index) const { return _ctrl[index] >= 0; }
+
+    Entry& operator[](size_type index) { return _entries[index].get(); }
+
+    const Entry& operator[](size_type index) const {
+        return _entries[index].get();
+    }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return as_view().find(key, hash, key_equal);
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        return find_empty_ctrl(_ctrl.data(), size(), hash);
+    }
+
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        _entries[index].construct(std::forward<E>(entry));
+        _entries[index].get().store_hash(hash);
+        set_ctrl(index, ctrl_fingerprint(hash));
+    }
+
+    // probes slot by slot, a group load could read past end
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        for (auto index = hash & (size() - 1); index < end; ++index) {
+            if (!used(index)) {
+                construct(index, hash, std::forward<E>(entry));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy(size_type index) {
+        _entries[index].destroy();
+        set_ctrl(index, ctrl_empty);
+    }
+
+    taken_entry<Entry> take(size_type index) {
+        return std::move_if_noexcept((*this)[index]);
+    }
+
+    void relocate(size_type from, size_type to) {
+        _entries[to].construct(std::move(_entries[from].get()));
+        set_ctrl(to, _ctrl[from]);
+        destroy(from);
+    }
+
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& hasher) const {
+        return _entries[index].get().hash(hasher) & (size() - 1);
+    }
+
+    void prefetch(std::size_t hash) const { as_view().prefetch(hash); }
+
+    view as_view() const {
+        return view(entries(), _ctrl.data(), _entries.size());
+    }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    std::size_t allocated_bytes() const {
+        return _entries.size() * sizeof(raw_entry<Entry>) +
+               _ctrl.size() * sizeof(ctrl_t);
+    }
+
+    template <typename Fn>
+    void for_each_array(Fn fn) const {
+        fn(static_cast<const void*>(_entries.data()),
+           _entries.size() * sizeof(Entry));
+        fn(static_cast<const void*>(_ctrl.data()),
+           _ctrl.size() * sizeof(ctrl_t));
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the entries
+    // of other
+    void copy_entries(const control_byte_table& other) {
+        if (trivially_copyable_entry<Entry>::value) {
+            _entries.assign(other._entries.begin(), other._entries.end());
+            _ctrl.assign(other._ctrl.begin(), other._ctrl.end());
+            return;
+        }
+
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(other[index]);
+            set_ctrl(index, other._ctrl[index]);
+        }
+    }
+
+    void move_entries(control_byte_table& other) {
+        _entries.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(std::move(other[index]));
+            set_ctrl(index, other._ctrl[index]);
+        }
+    }
+
+    // views see the raw entries as the entries they hold
+    const Entry* entries() const {
+        static_assert(sizeof(raw_entry<Entry>) == sizeof(Entry),
+                      "raw entries have to be laid out as entries");
+        return reinterpret_cast<const Entry*>(_entries.data());
+    }
+
+    // tables smaller than a group wrap several times in the mirrored bytes
+    void set_ctrl(size_type index, ctrl_t value) {
+        for (; index < _ctrl.size(); index += size()) {
+            _ctrl[index] = value;
+        }
+    }
+
+    entry_vector _entries;
+    ctrl_vector _ctrl;
+};
+
+} // namespace detail
+
+// separate control byte array probed a group at a time with SIMD compares
+struct control_byte_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::control_byte_table<Entry, Allocator>;
+};
+
+} // namespace io
+
+#endif
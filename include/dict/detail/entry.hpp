@@ -1,22 +1,166 @@
 #ifndef DICT_ENTRY_HPP
 #define DICT_ENTRY_HPP
 
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
 #include "key_value.hpp"
 
 namespace io {
 
+// Whether a dict stores the full hash next to each entry. Rehashing and the
+// backward shift in erase then never call the hasher again and lookups only
+// call KeyEqual if the hashes match. Like libstdc++'s __cache_hash_code this
+// is opt in, it costs 8 bytes per slot and only pays off for keys which are
+// expensive to hash or compare. By default only std::basic_string keys cache
+// their hash, specialise this to change it.
+template <typename Key, typename Hasher>
+struct cache_hash : std::false_type {};
+
+template <typename Char, typename Traits, typename Alloc, typename Hasher>
+struct cache_hash<std::basic_string<Char, Traits, Alloc>, Hasher>
+    : std::true_type {};
+
 namespace detail {
 
-template <typename Key, typename Value>
+// the payload stored per slot, occupancy is tracked by the table
+template <typename Key, typename Value, bool CacheHash = false>
 struct dict_entry {
+    using key_type = Key;
+    using value_type = typename detail::key_value<Key, Value>::value_type;
+
+    detail::key_value<Key, Value> kv;
+
+    dict_entry() : kv() {}
+    explicit dict_entry(detail::key_value<Key, Value>&& kv)
+        : kv(std::move(kv)) {}
+    explicit dict_entry(const detail::key_value<Key, Value>& kv) : kv(kv) {}
+
+    const Key& key() const { return kv.view.first; }
+
+    template <typename Hasher>
+    std::size_t hash(const Hasher& hasher) const {
+        return hasher(key());
+    }
+
+    void store_hash(std::size_t /* hash */) {}
+
+    template <typename K, typename KeyEqual>
+    bool equals(const K& other, std::size_t /* hash */,
+                const KeyEqual& key_equal) const {
+        return key_equal(key(), other);
+    }
+};
+
+template <typename Key, typename Value>
+struct dict_entry<Key, Value, true> {
+    using key_type = Key;
+    using value_type = typename detail::key_value<Key, Value>::value_type;
+
     detail::key_value<Key, Value> kv;
-    bool used;
+    std::size_t hash_code;
+
+    dict_entry() : kv(), hash_code() {}
+    explicit dict_entry(detail::key_value<Key, Value>&& kv)
+        : kv(std::move(kv)), hash_code() {}
+    explicit dict_entry(const detail::key_value<Key, Value>& kv)
+        : kv(kv), hash_code() {}
 
-    dict_entry() : kv(), used(false) {}
-    template<typename KV>
-    dict_entry(KV&& kv, bool used) : kv(std::forward<KV>(kv)), used(used) {}
+    const Key& key() const { return kv.view.first; }
+
+    template <typename Hasher>
+    std::size_t hash(const Hasher& /* hasher */) const {
+        return hash_code;
+    }
+
+    void store_hash(std::size_t hash) { hash_code = hash; }
+
+    template <typename K, typename KeyEqual>
+    bool equals(const K& other, std::size_t hash,
+                const KeyEqual& key_equal) const {
+        return hash_code == hash && key_equal(key(), other);
+    }
+};
+
+// Uninitialised storage for one entry. Only used slots hold a live entry,
+// tables construct and destroy them as slots are filled and freed so free
+// slots cost neither a Key() nor a Value().
+template <typename Entry>
+class raw_entry {
+public:
+    // leaves the storage uninitialised, also when value initialised
+    raw_entry() noexcept {}
+
+    Entry& get() noexcept { return *reinterpret_cast<Entry*>(&_storage); }
+
+    const Entry& get() const noexcept {
+        return *reinterpret_cast<const Entry*>(&_storage);
+    }
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        ::new (static_cast<void*>(&_storage))
+            Entry(std::forward<Args>(args)...);
+    }
+
+    void destroy() noexcept { get().~Entry(); }
+
+private:
+    typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type
+        _storage;
 };
 
+// key_value's destructor is never trivial, but it only destroys the pair
+template <typename Entry>
+struct trivially_destructible_entry
+    : std::is_trivially_destructible<typename Entry::value_type> {};
+
+// entries a table can copy byte by byte, slots included
+template <typename Entry>
+struct trivially_copyable_entry
+    : std::integral_constant<
+          bool, std::is_trivially_copy_constructible<
+                    typename Entry::value_type>::value &&
+                    trivially_destructible_entry<Entry>::value> {};
+
+// what take(i) of a table returns for construct() of another table: the
+// entry itself, moved if that can't throw
+template <typename Entry>
+using taken_entry =
+    decltype(std::move_if_noexcept(std::declval<Entry&>()));
+
+// Empties the array `to` of a table that is copy assigned and gives it the
+// allocator of `from` if propagate_on_container_copy_assignment says so, the
+// allocator aware assignment of an empty array does both.
+template <typename Array>
+void copy_assign_allocator(Array& to, const Array& from) {
+    const Array empty(from.get_allocator());
+    to = empty;
+}
+
+// Whether a table that is move assigned can take over the arrays of the
+// other one. Otherwise its allocator couldn't free them and the entries have
+// to be moved one by one.
+template <typename Alloc>
+bool can_take_arrays(const Alloc& to, const Alloc& from) {
+    return std::allocator_traits<
+               Alloc>::propagate_on_container_move_assignment::value ||
+           to == from;
+}
+
+// move assignment of a table only allocates, and so can throw, if this is
+// false
+template <typename Alloc>
+struct always_takes_arrays
+    : std::integral_constant<
+          bool, std::allocator_traits<
+                    Alloc>::propagate_on_container_move_assignment::value ||
+                    std::allocator_traits<Alloc>::is_always_equal::value> {};
+
 } // namespace detail
 
 } // namespace io
@@ -0,0 +1,325 @@
+#ifndef DICT_FLAG_TABLE_HPP
+#define DICT_FLAG_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "entry.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Tables own the slots of a dict and track which of them are in use. The dict
+// does the hashing and passes the full hash to all table operations. Every
+// table provides:
+//
+//  - size(), resize(n) (only called on a fresh table), swap(other) and
+//    clear(), which only has to reset the used slots
+//  - copy and move construction and assignment, only used slots hold a live
+//    entry so copying and destroying a table only visits those. Assignments
+//    keep the table's allocator unless the propagate_on_container_* traits
+//    say otherwise, and copy or move the entries into its arrays then
+//  - used(i) and operator[](i) to access the entry in slot i
+//  - find(key, hash, key_equal) which returns {index, true} on a hit and
+//    {slot a new element has to go to, false} on a miss
+//  - find_slot(hash) which returns the slot for a key known to be absent
+//  - construct(i, hash, entry) and destroy(i) to fill/empty a slot
+//  - construct_before(end, hash, entry) which does construct(find_slot(hash),
+//    ...) if that only touches slots in [home slot, end) and returns whether
+//    it did, this lets threads fill disjoint parts of a table in parallel
+//  - take(i) whose result construct() of another table accepts to move the
+//    entry of slot i there, slot i must still be destroyed afterwards
+//  - relocate(from, to) to move an entry into the empty slot `to`, as used by
+//    the backward shift in erase
+//  - next_used(i) which returns the first used slot >= i or size()
+//  - home_index(i, hasher) which returns the slot the entry in i hashes to
+//  - prefetch(hash) which pulls in whatever a lookup of hash touches first
+//  - allocated_bytes() which returns the bytes of all memory it allocated
+//  - a view type, a read only table over arrays it doesn't own, offering
+//    size(), data() (its first array), used(i), operator[](i) and
+//    next_used(i), and as_view() which returns one over the table's own
+//    arrays. Iterators hold views, so they keep pointing at the same entries
+//    when the tables of two dicts are swapped or moved.
+//
+// For mapping a table from a file every table except node_table, which only
+// holds pointers, also provides:
+//
+//  - layout(), a number unique to the table type and its memory layout
+//  - for_each_array(fn) which calls fn(data, bytes) for each of its arrays
+//  - a view constructible from (arrays, bytes, size) which also offers
+//    find(key, hash, key_equal) and prefetch(hash). The table's own lookups
+//    go through a view of itself.
+
+// plain linear probing with the occupancy flag stored next to every entry
+template <typename Entry, typename Allocator>
+class flag_table {
+    struct slot {
+        raw_entry<Entry> entry;
+        bool used;
+
+        slot() : used(false) {}
+    };
+
+    using slot_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<slot>;
+    using slot_vector = std::vector<slot, slot_allocator>;
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename slot_vector::size_type;
+    using difference_type = typename slot_vector::difference_type;
+    using allocator_type = slot_allocator;
+
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename slot_vector::size_type;
+
+        view() : _slots(nullptr), _size(0) {}
+
+        view(const slot* slots, size_type size) : _slots(slots), _size(size) {}
+
+        view(const void* const* arrays, const std::size_t* bytes,
+             size_type size)
+            : view(static_cast<const slot*>(arrays[0]), size) {
+            if (bytes[0] != size * sizeof(slot)) {
+                throw std::runtime_error("Table arrays don't match its size");
+            }
+        }
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _slots; }
+
+        bool used(size_type index) const { return _slots[index].used; }
+
+        const Entry& operator[](size_type index) const {
+            return _slots[index].entry.get();
+        }
+
+        template <typename K, typename KeyEqual>
+        std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                        const KeyEqual& key_equal) const {
+            auto index = hash & (_size - 1);
+
+            while (_slots[index].used) {
+                if (_slots[index].entry.get().equals(key, hash, key_equal)) {
+                    return { index, true };
+                }
+
+                index = (index + 1) & (_size - 1);
+            }
+
+            return { index, false };
+        }
+
+        void prefetch(std::size_t hash) const {
+            detail::prefetch(&_slots[hash & (_size - 1)]);
+        }
+
+        size_type next_used(size_type index) const {
+            while (index < _size && !_slots[index].used) {
+                ++index;
+            }
+
+            return index;
+        }
+
+    private:
+        const slot* _slots;
+        size_type _size;
+    };
+
+    static constexpr std::uint32_t layout() { return 1; }
+
+    explicit flag_table(const Allocator& alloc)
+        : _slots(slot_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    flag_table(const flag_table& other)
+        : flag_table(std::allocator_traits<slot_allocator>::
+                         select_on_container_copy_construction(
+                             other.get_allocator())) {
+        copy_entries(other);
+    }
+
+    flag_table(flag_table&& other) noexcept = default;
+
+    flag_table& operator=(const flag_table& other) {
+        if (this != &other) {
+            clear();
+            copy_assign_allocator(_slots, other._slots);
+            copy_entries(other);
+        }
+        return *this;
+    }
+
+    flag_table& operator=(flag_table&& other) noexcept(
+        always_takes_arrays<slot_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(get_allocator(), other.get_allocator())) {
+                _slots = std::move(other._slots);
+            } else {
+                move_entries(other);
+            }
+        }
+        return *this;
+    }
+
+    ~flag_table() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _slots[index].entry.destroy();
+            }
+        }
+    }
+
+    allocator_type get_allocator() const { return _slots.get_allocator(); }
+
+    size_type size() const noexcept { return _slots.size(); }
+
+    void resize(size_type new_size) { _slots.resize(new_size); }
+
+    void clear() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            destroy(index);
+        }
+    }
+
+    void swap(flag_table& other) { _slots.swap(other._slots); }
+
+    bool used(size_type index) const { return _slots[index].used; }
+
+    Entry& operator[](size_type index) { return _slots[index].entry.get(); }
+
+    const Entry& operator[](size_type index) const {
+        return _slots[index].entry.get();
+    }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return as_view().find(key, hash, key_equal);
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        auto index = hash & (size() - 1);
+
+        while (_slots[index].used) {
+            index = next_index(index);
+        }
+
+        return index;
+    }
+
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        _slots[index].entry.construct(std::forward<E>(entry));
+        _slots[index].entry.get().store_hash(hash);
+        _slots[index].used = true;
+    }
+
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        for (auto index = hash & (size() - 1); index < end; ++index) {
+            if (!_slots[index].used) {
+                construct(index, hash, std::forward<E>(entry));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy(size_type index) {
+        _slots[index].entry.destroy();
+        _slots[index].used = false;
+    }
+
+    taken_entry<Entry> take(size_type index) {
+        return std::move_if_noexcept((*this)[index]);
+    }
+
+    void relocate(size_type from, size_type to) {
+        _slots[to].entry.construct(std::move(_slots[from].entry.get()));
+        _slots[to].used = true;
+        destroy(from);
+    }
+
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& hasher) const {
+        return _slots[index].entry.get().hash(hasher) & (size() - 1);
+    }
+
+    void prefetch(std::size_t hash) const { as_view().prefetch(hash); }
+
+    view as_view() const { return view(_slots.data(), _slots.size()); }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    std::size_t allocated_bytes() const { return _slots.size() * sizeof(slot); }
+
+    template <typename Fn>
+    void for_each_array(Fn fn) const {
+        fn(static_cast<const void*>(_slots.data()),
+           _slots.size() * sizeof(slot));
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the entries
+    // of other
+    void copy_entries(const flag_table& other) {
+        if (trivially_copyable_entry<Entry>::value) {
+            _slots.assign(other._slots.begin(), other._slots.end());
+            return;
+        }
+
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _slots[index].entry.construct(other[index]);
+            _slots[index].used = true;
+        }
+    }
+
+    void move_entries(flag_table& other) {
+        _slots.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _slots[index].entry.construct(std::move(other[index]));
+            _slots[index].used = true;
+        }
+    }
+
+    size_type next_index(size_type index) const {
+        return (index + 1) & (size() - 1);
+    }
+
+    slot_vector _slots;
+};
+
+} // namespace detail
+
+// default storage, the occupancy flag lives inline with every entry
+struct inline_flag_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::flag_table<Entry, Allocator>;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef DICT_GROUP_HPP
+#define DICT_GROUP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "math_util.hpp"
+
+namespace io {
+
+namespace detail {
+
+// One control byte per slot: a used slot stores a 7 bit fingerprint of its
+// hash, an empty slot has the high bit set. Erasing uses backward shifting so
+// there is no separate deleted state.
+using ctrl_t = signed char;
+
+constexpr ctrl_t ctrl_empty = -128;
+
+// The low bits select the slot, so keys colliding on it only differ in the
+// high bits. Folding both in also keeps weak hashes like the identity hash of
+// std::hash<int> from mapping every key to the same fingerprint.
+constexpr ctrl_t ctrl_fingerprint(std::size_t hash) {
+    return static_cast<ctrl_t>(
+        (hash ^ (hash >> (sizeof(std::size_t) * 8 - 7))) & 0x7f);
+}
+
+// A group of consecutive control bytes matched at once. All match functions
+// return a bitmask where bit i corresponds to the i-th byte of the group.
+#if defined(__AVX2__)
+
+struct ctrl_group {
+    static constexpr std::size_t width() { return 32; }
+
+    explicit ctrl_group(const ctrl_t* pos)
+        : _ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+    std::uint32_t match(ctrl_t fingerprint) const {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_set1_epi8(fingerprint), _ctrl)));
+    }
+
+    std::uint32_t match_empty() const {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_ctrl));
+    }
+
+    std::uint32_t match_used() const { return ~match_empty(); }
+
+    __m256i _ctrl;
+};
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+struct ctrl_group {
+    static constexpr std::size_t width() { return 16; }
+
+    explicit ctrl_group(const ctrl_t* pos)
+        : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    std::uint32_t match(ctrl_t fingerprint) const {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_set1_epi8(fingerprint), _ctrl)));
+    }
+
+    std::uint32_t match_empty() const {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_ctrl));
+    }
+
+    std::uint32_t match_used() const { return ~match_empty() & 0xffff; }
+
+    __m128i _ctrl;
+};
+
+#else
+
+struct ctrl_group {
+    static constexpr std::size_t width() { return 8; }
+
+    explicit ctrl_group(const ctrl_t* pos) : _pos(pos) {}
+
+    std::uint32_t match(ctrl_t fingerprint) const {
+        std::uint32_t res = 0;
+        for (std::size_t i = 0; i != width(); ++i) {
+            res |= std::uint32_t(_pos[i] == fingerprint) << i;
+        }
+        return res;
+    }
+
+    std::uint32_t match_empty() const {
+        std::uint32_t res = 0;
+        for (std::size_t i = 0; i != width(); ++i) {
+            res |= std::uint32_t(_pos[i] < 0) << i;
+        }
+        return res;
+    }
+
+    std::uint32_t match_used() const { return ~match_empty() & 0xff; }
+
+    const ctrl_t* _pos;
+};
+
+#endif
+
+// The probes of tables which keep their control bytes in an array of size
+// plus width() - 1 mirrored bytes, shared by control_byte_table and
+// node_table, which only differ in where the entries live.
+
+// Loads the control bytes a group at a time and calls matches(index) for
+// every slot whose fingerprint matches until it returns true. Returns
+// {that slot, true}, or {the first empty slot, false} on a miss.
+template <typename Matches>
+std::pair<std::size_t, bool> probe_ctrl(const ctrl_t* ctrl, std::size_t size,
+                                        std::size_t hash, Matches matches) {
+    const auto fingerprint = ctrl_fingerprint(hash);
+    const auto mask = size - 1;
+    auto index = hash & mask;
+
+    while (true) {
+        ctrl_group group(&ctrl[index]);
+        auto empty = group.match_empty();
+        // slots behind the first empty one are not part of the probe
+        auto probe_end =
+            empty ? count_trailing_zeros(empty) : ctrl_group::width();
+
+        for (auto hits = group.match(fingerprint); hits; hits &= hits - 1) {
+            auto offset = count_trailing_zeros(hits);
+            if (offset >= probe_end) {
+                break;
+            }
+
+            auto candidate = (index + offset) & mask;
+            if (matches(candidate)) {
+                return { candidate, true };
+            }
+        }
+
+        if (empty) {
+            return { (index + probe_end) & mask, false };
+        }
+
+        index = (index + ctrl_group::width()) & mask;
+    }
+}
+
+// the first empty slot of the probe sequence of hash
+inline std::size_t find_empty_ctrl(const ctrl_t* ctrl, std::size_t size,
+                                   std::size_t hash) {
+    const auto mask = size - 1;
+    auto index = hash & mask;
+
+    while (true) {
+        auto empty = ctrl_group(&ctrl[index]).match_empty();
+        if (empty) {
+            return (index + count_trailing_zeros(empty)) & mask;
+        }
+
+        index = (index + ctrl_group::width()) & mask;
+    }
+}
+
+// the first used slot >= index or size
+inline std::size_t next_used_ctrl(const ctrl_t* ctrl, std::size_t size,
+                                  std::size_t index) {
+    while (index < size) {
+        auto used = ctrl_group(&ctrl[index]).match_used();
+        if (used) {
+            index += count_trailing_zeros(used);
+            return index < size ? index : size;
+        }
+
+        index += ctrl_group::width();
+    }
+
+    return size;
+}
+
+} // namespace detail
+
+} // namespace io
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef DICT_HASHED_KEY_HPP
+#define DICT_HASHED_KEY_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+namespace io {
+
+// A key together with its hash as returned by dict::prehash(). It can be
+// passed to every dict whose hasher returns the same hash for the key, e.g.
+// all dicts sharing a stateless hasher. Only a reference to the key is kept
+// so the key has to outlive it.
+template <typename K>
+class hashed_key {
+public:
+    hashed_key(const K& key, std::size_t hash) : _key(&key), _hash(hash) {}
+
+    const K& key() const { return *_key; }
+
+    std::size_t hash() const { return _hash; }
+
+private:
+    const K* _key;
+    std::size_t _hash;
+};
+
+namespace detail {
+
+template <typename T>
+struct is_hashed_key : std::false_type {};
+
+template <typename K>
+struct is_hashed_key<hashed_key<K>> : std::true_type {};
+
+} // namespace detail
+
+} // namespace io
+
+#endif
@@ -1,68 +1,88 @@
 #ifndef DICT_ITERATOR_HPP
 #define DICT_ITERATOR_HPP
 
-#include <vector>
-#include <tuple>
+#include <cstddef>
 
 #include <boost/iterator/iterator_facade.hpp>
 
-#include "key_value.hpp"
-#include "entry.hpp"
-
 namespace io {
 
+template <typename Key, typename Value, typename Hasher, typename KeyEqual,
+          typename Allocator, typename Storage>
+class dict;
+
 namespace detail {
 
-// iterators
-template <typename value_type, typename Iter>
+// iterators, while a dict rehashes incrementally they first walk the
+// entries left in the old table and then continue in the next one. They hold
+// views of the tables rather than the tables, so like the iterators of std
+// containers they stay valid when two dicts are swapped or one is moved.
+template <typename value_type, typename View>
 class dict_iterator_base
-    : public boost::iterator_facade<dict_iterator_base<value_type, Iter>,
+    : public boost::iterator_facade<dict_iterator_base<value_type, View>,
                                     value_type, boost::forward_traversal_tag> {
 public:
-    dict_iterator_base() : _ptr(), _end() {}
-    dict_iterator_base(Iter p, Iter end) : _ptr(p), _end(end) {
-        if (_ptr != _end && !_ptr->used) {
-            increment();
-        }
+    dict_iterator_base() : _table(), _next(), _index() {}
+    dict_iterator_base(const View& table, std::size_t index)
+        : dict_iterator_base(table, View(), index) {}
+    dict_iterator_base(const View& table, std::size_t index,
+                       bool /* skip_test */)
+        : _table(table), _next(), _index(index) {}
+    dict_iterator_base(const View& table, const View& next, std::size_t index)
+        : _table(table), _next(next), _index(table.next_used(index)) {
+        skip_to_next_table();
     }
-    dict_iterator_base(Iter p, Iter end, bool /* skip_test */)
-        : _ptr(p), _end(end) {}
+    dict_iterator_base(const View& table, const View& next, std::size_t index,
+                       bool /* skip_test */)
+        : _table(table), _next(next), _index(index) {}
 
-    template <typename Other, typename OtherIter>
-    dict_iterator_base(const dict_iterator_base<Other, OtherIter>& other)
-        : _ptr(other._ptr), _end(other._end) {}
+    template <typename Other>
+    dict_iterator_base(const dict_iterator_base<Other, View>& other)
+        : _table(other._table), _next(other._next), _index(other._index) {}
 
 private:
     friend class boost::iterator_core_access;
     template <typename, typename>
     friend class dict_iterator_base;
+    // range erase needs the table and slot of its bounds
+    template <typename, typename, typename, typename, typename, typename>
+    friend class io::dict;
 
     void increment() {
-        do {
-            ++_ptr;
-        } while (_ptr != _end && !_ptr->used);
+        _index = _table.next_used(_index + 1);
+        skip_to_next_table();
     }
 
-    template <typename OtherValue, typename OtherIter>
-    bool equal(const dict_iterator_base<OtherValue, OtherIter>& other) const {
-        return this->_ptr == other._ptr;
+    void skip_to_next_table() {
+        if (_next.data() && _index == _table.size()) {
+            _table = _next;
+            _next = View();
+            _index = _table.next_used(0);
+        }
     }
 
-    value_type& dereference() const { return _ptr->kv.const_view; }
+    template <typename OtherValue>
+    bool equal(const dict_iterator_base<OtherValue, View>& other) const {
+        return this->_index == other._index &&
+               this->_table.data() == other._table.data();
+    }
+
+    // views only hand out const entries, those of a dict aren't const
+    value_type& dereference() const {
+        return const_cast<value_type&>(_table[_index].kv.const_view);
+    }
 
-    Iter _ptr;
-    const Iter _end;
+    View _table;
+    View _next;
+    std::size_t _index;
 };
 
-template <typename Key, typename Value>
-using dict_iterator = dict_iterator_base<
-    std::pair<const Key, Value>,
-    typename std::vector<detail::dict_entry<Key, Value>>::iterator>;
+template <typename View>
+using dict_iterator = dict_iterator_base<typename View::value_type, View>;
 
-template <typename Key, typename Value>
-using const_dict_iterator = dict_iterator_base<
-    const std::pair<const Key, Value>,
-    typename std::vector<detail::dict_entry<Key, Value>>::const_iterator>;
+template <typename View>
+using const_dict_iterator =
+    dict_iterator_base<const typename View::value_type, View>;
 
 } // detail
 
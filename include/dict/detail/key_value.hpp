@@ -1,6 +1,7 @@
 #ifndef DICT_KEY_VALUE_HPP
 #define DICT_KEY_VALUE_HPP
 
+#include <tuple>
 #include <utility>
 
 namespace io {
@@ -30,6 +31,10 @@ union key_value {
     template <typename K, typename V>
     key_value(K&& k, V&& v)
         : const_view(std::forward<K>(k), std::forward<V>(v)) {}
+    template <typename... KeyArgs, typename... ValueArgs>
+    key_value(std::piecewise_construct_t, std::tuple<KeyArgs...> k,
+              std::tuple<ValueArgs...> v)
+        : const_view(std::piecewise_construct, std::move(k), std::move(v)) {}
 
     key_value(const key_value& other) : const_view(other.const_view) {}
 
@@ -1,13 +1,83 @@
+#ifndef DICT_MATH_UTIL_HPP
+#define DICT_MATH_UTIL_HPP
+
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 namespace io {
 
 namespace detail {
 
-std::size_t next_power_of_two(std::size_t value) {
+inline std::size_t next_power_of_two(std::size_t value) {
     return std::pow(2, std::ceil(std::log2(value)));
 }
 
+// index of the lowest set bit, value must not be zero
+inline unsigned count_trailing_zeros(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    unsigned count = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+constexpr std::uint64_t xor_shift_33(std::uint64_t value) {
+    return value ^ (value >> 33);
+}
+
+// murmur3's 64 bit finaliser, spreads every input bit over the whole word
+constexpr std::uint64_t mix_bits(std::uint64_t value) {
+    return xor_shift_33(xor_shift_33(xor_shift_33(value) *
+                                     0xff51afd7ed558ccdull) *
+                        0xc4ceb9fe1a85ec53ull);
+}
+
+// MurmurHash64A, reads the bytes eight at a time
+inline std::uint64_t hash_bytes(const char* data, std::size_t size) {
+    const std::uint64_t m = 0xc6a4a7935bd1e995ull;
+    std::uint64_t hash = size * m;
+
+    const char* end = data + size / 8 * 8;
+    for (; data != end; data += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        word *= m;
+        word ^= word >> 47;
+        word *= m;
+        hash ^= word;
+        hash *= m;
+    }
+
+    if (size % 8) {
+        std::uint64_t tail = 0;
+        for (auto i = size % 8; i != 0; --i) {
+            tail = (tail << 8) | static_cast<unsigned char>(data[i - 1]);
+        }
+        hash ^= tail;
+        hash *= m;
+    }
+
+    hash ^= hash >> 47;
+    hash *= m;
+    hash ^= hash >> 47;
+    return hash;
+}
+
+// maps the high 32 bits of value onto [0, range) without a division, range
+// must fit into 32 bits
+inline std::uint64_t reduce_range(std::uint64_t value, std::uint64_t range) {
+    return ((value >> 32) * range) >> 32;
+}
+
 } // detail
 
 } // io
+
+#endif
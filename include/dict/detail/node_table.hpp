@@ -0,0 +1,336 @@
+#ifndef DICT_NODE_TABLE_HPP
+#define DICT_NODE_TABLE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entry.hpp"
+#include "group.hpp"
+#include "math_util.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Probes control bytes like control_byte_table, with the same probe
+// functions, but the slots only hold pointers to entries allocated one by
+// one. Growing the table and the backward shift in erase move pointers
+// instead of entries, so references to elements stay valid until they are
+// erased, and a free slot costs a pointer and a control byte however big the
+// entry is.
+//
+// take(i) hands the node itself to a table with an equal allocator, its slot
+// is left with a null pointer which destroy() and the destructor skip.
+template <typename Entry, typename Allocator>
+class node_table {
+    using node_allocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Entry>;
+    using node_traits = std::allocator_traits<node_allocator>;
+    using node_pointer = typename node_traits::pointer;
+    using pointer_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<node_pointer>;
+    using ctrl_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<ctrl_t>;
+    using node_vector = std::vector<node_pointer, pointer_allocator>;
+    using ctrl_vector = std::vector<ctrl_t, ctrl_allocator>;
+
+    // the slot of another table whose node take() hands over
+    struct taken_node {
+        node_pointer& node;
+        const node_allocator& alloc;
+    };
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename node_vector::size_type;
+    using difference_type = typename node_vector::difference_type;
+    using allocator_type = node_allocator;
+
+    // only what iterators need, node tables aren't mapped from files
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename node_vector::size_type;
+
+        view() : _nodes(nullptr), _ctrl(nullptr), _size(0) {}
+
+        view(const node_pointer* nodes, const ctrl_t* ctrl, size_type size)
+            : _nodes(nodes), _ctrl(ctrl), _size(size) {}
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _nodes; }
+
+        bool used(size_type index) const { return _ctrl[index] >= 0; }
+
+        const Entry& operator[](size_type index) const {
+            return *_nodes[index];
+        }
+
+        size_type next_used(size_type index) const {
+            return next_used_ctrl(_ctrl, _size, index);
+        }
+
+    private:
+        const node_pointer* _nodes;
+        const ctrl_t* _ctrl;
+        size_type _size;
+    };
+
+    explicit node_table(const Allocator& alloc)
+        : _alloc(alloc), _nodes(pointer_allocator(alloc)),
+          _ctrl(ctrl_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    node_table(const node_table& other)
+        : node_table(node_traits::select_on_container_copy_construction(
+              other._alloc)) {
+        copy_nodes(other);
+    }
+
+    node_table(node_table&& other) noexcept = default;
+
+    node_table& operator=(const node_table& other) {
+        if (this != &other) {
+            clear();
+            assign_alloc(other._alloc,
+                         typename node_traits::
+                             propagate_on_container_copy_assignment());
+            copy_assign_allocator(_nodes, other._nodes);
+            copy_assign_allocator(_ctrl, other._ctrl);
+            copy_nodes(other);
+        }
+        return *this;
+    }
+
+    // taking over the arrays takes over the nodes as well
+    node_table& operator=(node_table&& other) noexcept(
+        always_takes_arrays<node_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(_alloc, other._alloc)) {
+                assign_alloc(other._alloc,
+                             typename node_traits::
+                                 propagate_on_container_move_assignment());
+                _nodes = std::move(other._nodes);
+                _ctrl = std::move(other._ctrl);
+            } else {
+                move_nodes(other);
+            }
+        }
+        return *this;
+    }
+
+    ~node_table() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            delete_node(_nodes[index]);
+        }
+    }
+
+    allocator_type get_allocator() const { return _alloc; }
+
+    size_type size() const noexcept { return _nodes.size(); }
+
+    void resize(size_type new_size) {
+        _nodes.resize(new_size);
+        _ctrl.assign(new_size + ctrl_group::width() - 1, ctrl_empty);
+    }
+
+    void clear() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            delete_node(_nodes[index]);
+        }
+        _ctrl.assign(_ctrl.size(), ctrl_empty);
+    }
+
+    void swap(node_table& other) {
+        swap_alloc(other._alloc,
+                   typename node_traits::propagate_on_container_swap());
+        _nodes.swap(other._nodes);
+        _ctrl.swap(other._ctrl);
+    }
+
+    bool used(size_type index) const { return _ctrl[index] >= 0; }
+
+    Entry& operator[](size_type index) { return *_nodes[index]; }
+
+    const Entry& operator[](size_type index) const { return *_nodes[index]; }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return probe_ctrl(_ctrl.data(), size(), hash, [&](size_type index) {
+            return _nodes[index]->equals(key, hash, key_equal);
+        });
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        return find_empty_ctrl(_ctrl.data(), size(), hash);
+    }
+
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        _nodes[index] = new_node(std::forward<E>(entry));
+        _nodes[index]->store_hash(hash);
+        set_ctrl(index, ctrl_fingerprint(hash));
+    }
+
+    // nodes from another allocator are moved into one of ours
+    void construct(size_type index, std::size_t hash, taken_node taken) {
+        if (taken.alloc == _alloc) {
+            _nodes[index] = taken.node;
+            taken.node = nullptr;
+        } else {
+            _nodes[index] = new_node(std::move_if_noexcept(*taken.node));
+        }
+        set_ctrl(index, ctrl_fingerprint(hash));
+    }
+
+    // probes slot by slot, a group load could read past end
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        for (auto index = hash & (size() - 1); index < end; ++index) {
+            if (!used(index)) {
+                construct(index, hash, std::forward<E>(entry));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy(size_type index) {
+        delete_node(_nodes[index]);
+        set_ctrl(index, ctrl_empty);
+    }
+
+    taken_node take(size_type index) { return { _nodes[index], _alloc }; }
+
+    void relocate(size_type from, size_type to) {
+        _nodes[to] = _nodes[from];
+        set_ctrl(to, _ctrl[from]);
+        set_ctrl(from, ctrl_empty);
+    }
+
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& hasher) const {
+        return _nodes[index]->hash(hasher) & (size() - 1);
+    }
+
+    // the node itself is only known once its pointer is loaded
+    void prefetch(std::size_t hash) const {
+        auto index = hash & (size() - 1);
+        detail::prefetch(&_ctrl[index]);
+        detail::prefetch(&_nodes[index]);
+    }
+
+    view as_view() const {
+        return view(_nodes.data(), _ctrl.data(), _nodes.size());
+    }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    // counts the nodes, which aren't tracked anywhere else
+    std::size_t allocated_bytes() const {
+        std::size_t nodes = 0;
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            ++nodes;
+        }
+
+        return _nodes.size() * sizeof(node_pointer) +
+               _ctrl.size() * sizeof(ctrl_t) + nodes * sizeof(Entry);
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the nodes of
+    // other
+    void copy_nodes(const node_table& other) {
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _nodes[index] = new_node(other[index]);
+            set_ctrl(index, other._ctrl[index]);
+        }
+    }
+
+    void move_nodes(node_table& other) {
+        _nodes.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _nodes[index] = new_node(std::move(other[index]));
+            set_ctrl(index, other._ctrl[index]);
+        }
+    }
+
+    // allocators which don't propagate, like std::pmr ones, needn't even be
+    // assignable
+    void assign_alloc(const node_allocator& other, std::true_type) {
+        _alloc = other;
+    }
+
+    void assign_alloc(const node_allocator&, std::false_type) {}
+
+    void swap_alloc(node_allocator& other, std::true_type) {
+        using std::swap;
+        swap(_alloc, other);
+    }
+
+    void swap_alloc(node_allocator&, std::false_type) {}
+
+    template <typename E>
+    node_pointer new_node(E&& entry) {
+        auto node = node_traits::allocate(_alloc, 1);
+        try {
+            node_traits::construct(_alloc, std::addressof(*node),
+                                   std::forward<E>(entry));
+        } catch (...) {
+            node_traits::deallocate(_alloc, node, 1);
+            throw;
+        }
+
+        return node;
+    }
+
+    void delete_node(node_pointer node) {
+        if (node) {
+            node_traits::destroy(_alloc, std::addressof(*node));
+            node_traits::deallocate(_alloc, node, 1);
+        }
+    }
+
+    // tables smaller than a group wrap several times in the mirrored bytes
+    void set_ctrl(size_type index, ctrl_t value) {
+        for (; index < _ctrl.size(); index += size()) {
+            _ctrl[index] = value;
+        }
+    }
+
+    node_allocator _alloc;
+    node_vector _nodes;
+    ctrl_vector _ctrl;
+};
+
+} // namespace detail
+
+// control bytes and pointers to individually allocated entries, references to
+// elements survive rehashing
+struct node_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::node_table<Entry, Allocator>;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef DICT_PREFETCH_HPP
+#define DICT_PREFETCH_HPP
+
+namespace io {
+
+namespace detail {
+
+// hint to pull the cache line into all cache levels, a no-op if unsupported
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+} // namespace detail
+
+} // namespace io
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef DICT_ROBIN_HOOD_TABLE_HPP
+#define DICT_ROBIN_HOOD_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "entry.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Robin Hood hashing on top of linear probing. Every slot stores the distance
+// of its entry to its home slot and inserts take the place of the first entry
+// that is closer to its home than the new one, which keeps each cluster
+// sorted by home slot. A lookup can therefore stop as soon as it reaches an
+// entry that is closer to home than the key would be at that point.
+//
+// The distance is stored off by one so that zero marks an empty slot.
+template <typename Entry, typename Allocator>
+class robin_hood_table {
+    using distance_type = std::uint32_t;
+
+    struct slot {
+        raw_entry<Entry> entry;
+        distance_type distance;
+
+        slot() : distance(0) {}
+    };
+
+    using slot_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<slot>;
+    using slot_vector = std::vector<slot, slot_allocator>;
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename slot_vector::size_type;
+    using difference_type = typename slot_vector::difference_type;
+    using allocator_type = slot_allocator;
+
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename slot_vector::size_type;
+
+        view() : _slots(nullptr), _size(0) {}
+
+        view(const slot* slots, size_type size) : _slots(slots), _size(size) {}
+
+        view(const void* const* arrays, const std::size_t* bytes,
+             size_type size)
+            : view(static_cast<const slot*>(arrays[0]), size) {
+            if (bytes[0] != size * sizeof(slot)) {
+                throw std::runtime_error("Table arrays don't match its size");
+            }
+        }
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _slots; }
+
+        bool used(size_type index) const { return _slots[index].distance != 0; }
+
+        const Entry& operator[](size_type index) const {
+            return _slots[index].entry.get();
+        }
+
+        template <typename K, typename KeyEqual>
+        std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                        const KeyEqual& key_equal) const {
+            auto index = hash & (_size - 1);
+            distance_type distance = 1;
+
+            while (_slots[index].distance >= distance) {
+                // only entries with the same home can be equal
+                if (_slots[index].distance == distance &&
+                    _slots[index].entry.get().equals(key, hash, key_equal)) {
+                    return { index, true };
+                }
+
+                index = (index + 1) & (_size - 1);
+                ++distance;
+            }
+
+            return { index, false };
+        }
+
+        void prefetch(std::size_t hash) const {
+            detail::prefetch(&_slots[hash & (_size - 1)]);
+        }
+
+        size_type next_used(size_type index) const {
+            while (index < _size && !_slots[index].distance) {
+                ++index;
+            }
+
+            return index;
+        }
+
+    private:
+        const slot* _slots;
+        size_type _size;
+    };
+
+    static constexpr std::uint32_t layout() { return 4; }
+
+    explicit robin_hood_table(const Allocator& alloc)
+        : _slots(slot_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    robin_hood_table(const robin_hood_table& other)
+        : robin_hood_table(std::allocator_traits<slot_allocator>::
+                               select_on_container_copy_construction(
+                                   other.get_allocator())) {
+        copy_entries(other);
+    }
+
+    robin_hood_table(robin_hood_table&& other) noexcept = default;
+
+    robin_hood_table& operator=(const robin_hood_table& other) {
+        if (this != &other) {
+            clear();
+            copy_assign_allocator(_slots, other._slots);
+            copy_entries(other);
+        }
+        return *this;
+    }
+
+    robin_hood_table& operator=(robin_hood_table&& other) noexcept(
+        always_takes_arrays<slot_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(get_allocator(), other.get_allocator())) {
+                _slots = std::move(other._slots);
+            } else {
+                move_entries(other);
+            }
+        }
+        return *this;
+    }
+
+    ~robin_hood_table() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _slots[index].entry.destroy();
+            }
+        }
+    }
+
+    allocator_type get_allocator() const { return _slots.get_allocator(); }
+
+    size_type size() const noexcept { return _slots.size(); }
+
+    void resize(size_type new_size) { _slots.resize(new_size); }
+
+    void clear() {
+        for (auto index = next_used(0); index != size();
+             index = next_used(index + 1)) {
+            destroy(index);
+        }
+    }
+
+    void swap(robin_hood_table& other) { _slots.swap(other._slots); }
+
+    bool used(size_type index) const { return _slots[index].distance != 0; }
+
+    Entry& operator[](size_type index) { return _slots[index].entry.get(); }
+
+    const Entry& operator[](size_type index) const {
+        return _slots[index].entry.get();
+    }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return as_view().find(key, hash, key_equal);
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        auto index = hash & (size() - 1);
+        distance_type distance = 1;
+
+        while (_slots[index].distance >= distance) {
+            index = next_index(index);
+            ++distance;
+        }
+
+        return index;
+    }
+
+    // shifts the rest of the cluster up by one if the slot is taken
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        if (used(index)) {
+            auto empty = index;
+            while (used(empty)) {
+                empty = next_index(empty);
+            }
+
+            for (; empty != index; empty = prev_index(empty)) {
+                auto prev = prev_index(empty);
+                _slots[empty].entry.construct(
+                    std::move(_slots[prev].entry.get()));
+                _slots[empty].distance = _slots[prev].distance + 1;
+                destroy(prev);
+            }
+        }
+
+        _slots[index].entry.construct(std::forward<E>(entry));
+        _slots[index].entry.get().store_hash(hash);
+        _slots[index].distance =
+            ((index - (hash & (size() - 1))) & (size() - 1)) + 1;
+    }
+
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        auto index = hash & (size() - 1);
+        distance_type distance = 1;
+
+        while (index < end && _slots[index].distance >= distance) {
+            ++index;
+            ++distance;
+        }
+
+        // the rest of the run is shifted up into the next empty slot
+        auto empty = index;
+        while (empty < end && used(empty)) {
+            ++empty;
+        }
+
+        if (empty >= end) {
+            return false;
+        }
+
+        construct(index, hash, std::forward<E>(entry));
+        return true;
+    }
+
+    void destroy(size_type index) {
+        _slots[index].entry.destroy();
+        _slots[index].distance = 0;
+    }
+
+    taken_entry<Entry> take(size_type index) {
+        return std::move_if_noexcept((*this)[index]);
+    }
+
+    void relocate(size_type from, size_type to) {
+        _slots[to].entry.construct(std::move(_slots[from].entry.get()));
+        _slots[to].distance =
+            _slots[from].distance - ((from - to) & (size() - 1));
+        destroy(from);
+    }
+
+    // no need to hash, the distance tells us where the entry is from
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& /* hasher */) const {
+        return (index - (_slots[index].distance - 1)) & (size() - 1);
+    }
+
+    void prefetch(std::size_t hash) const { as_view().prefetch(hash); }
+
+    view as_view() const { return view(_slots.data(), _slots.size()); }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    std::size_t allocated_bytes() const { return _slots.size() * sizeof(slot); }
+
+    template <typename Fn>
+    void for_each_array(Fn fn) const {
+        fn(static_cast<const void*>(_slots.data()),
+           _slots.size() * sizeof(slot));
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the entries
+    // of other
+    void copy_entries(const robin_hood_table& other) {
+        if (trivially_copyable_entry<Entry>::value) {
+            _slots.assign(other._slots.begin(), other._slots.end());
+            return;
+        }
+
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _slots[index].entry.construct(other[index]);
+            _slots[index].distance = other._slots[index].distance;
+        }
+    }
+
+    void move_entries(robin_hood_table& other) {
+        _slots.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _slots[index].entry.construct(std::move(other[index]));
+            _slots[index].distance = other._slots[index].distance;
+        }
+    }
+
+    size_type next_index(size_type index) const {
+        return (index + 1) & (size() - 1);
+    }
+
+    size_type prev_index(size_type index) const {
+        return (index - 1) & (size() - 1);
+    }
+
+    slot_vector _slots;
+};
+
+} // namespace detail
+
+// Robin Hood insertion with early exit for misses
+struct robin_hood_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::robin_hood_table<Entry, Allocator>;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef DICT_SENTINEL_TABLE_HPP
+#define DICT_SENTINEL_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "entry.hpp"
+#include "prefetch.hpp"
+
+namespace io {
+
+namespace detail {
+
+// Linear probing where one key value, which can never be inserted, marks the
+// free slots, so an entry is just the key value pair. A free slot only holds
+// that key, the rest of its entry is uninitialised. The key is read straight
+// from the first bytes of a slot, which is where the pair starts.
+template <typename Entry, typename Allocator, typename EmptyKey>
+class sentinel_table {
+    using key_type = typename Entry::key_type;
+    using entry_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<raw_entry<Entry>>;
+    using entry_vector = std::vector<raw_entry<Entry>, entry_allocator>;
+
+    static_assert(std::is_scalar<key_type>::value,
+                  "sentinel storage needs integer, enum or pointer keys");
+
+    static key_type slot_key(const void* slot) {
+        key_type key;
+        std::memcpy(&key, slot, sizeof(key_type));
+        return key;
+    }
+
+    static bool empty(key_type key) { return key == EmptyKey::value(); }
+
+public:
+    using entry_type = Entry;
+    using value_type = typename Entry::value_type;
+    using size_type = typename entry_vector::size_type;
+    using difference_type = typename entry_vector::difference_type;
+    using allocator_type = entry_allocator;
+
+    class view {
+    public:
+        using entry_type = Entry;
+        using value_type = typename Entry::value_type;
+        using size_type = typename entry_vector::size_type;
+
+        view() : _entries(nullptr), _size(0) {}
+
+        view(const Entry* entries, size_type size)
+            : _entries(entries), _size(size) {}
+
+        view(const void* const* arrays, const std::size_t* bytes,
+             size_type size)
+            : view(static_cast<const Entry*>(arrays[0]), size) {
+            if (bytes[0] != size * sizeof(Entry)) {
+                throw std::runtime_error("Table arrays don't match its size");
+            }
+        }
+
+        size_type size() const noexcept { return _size; }
+
+        const void* data() const noexcept { return _entries; }
+
+        bool used(size_type index) const {
+            return !empty(slot_key(&_entries[index]));
+        }
+
+        const Entry& operator[](size_type index) const {
+            return _entries[index];
+        }
+
+        // the key of every slot is compared to the empty key and, if it
+        // isn't empty, to the key looked up, there is nothing else to check
+        template <typename K, typename KeyEqual>
+        std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                        const KeyEqual& key_equal) const {
+            auto index = hash & (_size - 1);
+
+            while (used(index)) {
+                if (_entries[index].equals(key, hash, key_equal)) {
+                    return { index, true };
+                }
+
+                index = (index + 1) & (_size - 1);
+            }
+
+            return { index, false };
+        }
+
+        void prefetch(std::size_t hash) const {
+            detail::prefetch(&_entries[hash & (_size - 1)]);
+        }
+
+        size_type next_used(size_type index) const {
+            while (index < _size && !used(index)) {
+                ++index;
+            }
+
+            return index;
+        }
+
+    private:
+        const Entry* _entries;
+        size_type _size;
+    };
+
+    static constexpr std::uint32_t layout() { return 5; }
+
+    explicit sentinel_table(const Allocator& alloc)
+        : _entries(entry_allocator(alloc)) {}
+
+    // delegates so that the destructor cleans up if copying an entry throws
+    sentinel_table(const sentinel_table& other)
+        : sentinel_table(std::allocator_traits<entry_allocator>::
+                             select_on_container_copy_construction(
+                                 other.get_allocator())) {
+        copy_entries(other);
+    }
+
+    sentinel_table(sentinel_table&& other) noexcept = default;
+
+    sentinel_table& operator=(const sentinel_table& other) {
+        if (this != &other) {
+            clear();
+            copy_assign_allocator(_entries, other._entries);
+            copy_entries(other);
+        }
+        return *this;
+    }
+
+    sentinel_table& operator=(sentinel_table&& other) noexcept(
+        always_takes_arrays<entry_allocator>::value) {
+        if (this != &other) {
+            clear();
+            if (can_take_arrays(get_allocator(), other.get_allocator())) {
+                _entries = std::move(other._entries);
+            } else {
+                move_entries(other);
+            }
+        }
+        return *this;
+    }
+
+    ~sentinel_table() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _entries[index].destroy();
+            }
+        }
+    }
+
+    allocator_type get_allocator() const { return _entries.get_allocator(); }
+
+    size_type size() const noexcept { return _entries.size(); }
+
+    void resize(size_type new_size) {
+        _entries.resize(new_size);
+        fill_empty();
+    }
+
+    // a fill of the empty key, used entries are only visited if they need
+    // to be destroyed
+    void clear() {
+        if (!trivially_destructible_entry<Entry>::value) {
+            for (auto index = next_used(0); index != size();
+                 index = next_used(index + 1)) {
+                _entries[index].destroy();
+            }
+        }
+        fill_empty();
+    }
+
+    void swap(sentinel_table& other) { _entries.swap(other._entries); }
+
+    bool used(size_type index) const {
+        return !empty(slot_key(&_entries[index]));
+    }
+
+    Entry& operator[](size_type index) { return _entries[index].get(); }
+
+    const Entry& operator[](size_type index) const {
+        return _entries[index].get();
+    }
+
+    template <typename K, typename KeyEqual>
+    std::pair<size_type, bool> find(const K& key, std::size_t hash,
+                                    const KeyEqual& key_equal) const {
+        return as_view().find(key, hash, key_equal);
+    }
+
+    size_type find_slot(std::size_t hash) const {
+        auto index = hash & (size() - 1);
+
+        while (used(index)) {
+            index = next_index(index);
+        }
+
+        return index;
+    }
+
+    // the empty key can't be told apart from a free slot
+    template <typename E>
+    void construct(size_type index, std::size_t hash, E&& entry) {
+        if (empty(entry.key())) {
+            throw std::invalid_argument("The empty key can't be inserted");
+        }
+
+        _entries[index].construct(std::forward<E>(entry));
+        _entries[index].get().store_hash(hash);
+    }
+
+    template <typename E>
+    bool construct_before(size_type end, std::size_t hash, E&& entry) {
+        for (auto index = hash & (size() - 1); index < end; ++index) {
+            if (!used(index)) {
+                construct(index, hash, std::forward<E>(entry));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void destroy(size_type index) {
+        _entries[index].destroy();
+        set_empty(index);
+    }
+
+    taken_entry<Entry> take(size_type index) {
+        return std::move_if_noexcept((*this)[index]);
+    }
+
+    void relocate(size_type from, size_type to) {
+        _entries[to].construct(std::move(_entries[from].get()));
+        destroy(from);
+    }
+
+    template <typename Hasher>
+    size_type home_index(size_type index, const Hasher& hasher) const {
+        return _entries[index].get().hash(hasher) & (size() - 1);
+    }
+
+    void prefetch(std::size_t hash) const { as_view().prefetch(hash); }
+
+    view as_view() const { return view(entries(), _entries.size()); }
+
+    size_type next_used(size_type index) const {
+        return as_view().next_used(index);
+    }
+
+    std::size_t allocated_bytes() const {
+        return _entries.size() * sizeof(raw_entry<Entry>);
+    }
+
+    template <typename Fn>
+    void for_each_array(Fn fn) const {
+        fn(static_cast<const void*>(_entries.data()),
+           _entries.size() * sizeof(Entry));
+    }
+
+private:
+    // fills this table, which has no slots yet, with copies of the entries
+    // of other
+    void copy_entries(const sentinel_table& other) {
+        if (trivially_copyable_entry<Entry>::value) {
+            _entries.assign(other._entries.begin(), other._entries.end());
+            return;
+        }
+
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(other[index]);
+        }
+    }
+
+    void move_entries(sentinel_table& other) {
+        _entries.clear();
+        resize(other.size());
+        for (auto index = other.next_used(0); index != size();
+             index = other.next_used(index + 1)) {
+            _entries[index].construct(std::move(other[index]));
+        }
+    }
+
+    // views see the raw entries as the entries they hold
+    const Entry* entries() const {
+        static_assert(sizeof(raw_entry<Entry>) == sizeof(Entry),
+                      "raw entries have to be laid out as entries");
+        return reinterpret_cast<const Entry*>(_entries.data());
+    }
+
+    void set_empty(size_type index) {
+        const key_type key = EmptyKey::value();
+        std::memcpy(static_cast<void*>(&_entries[index]), &key,
+                    sizeof(key_type));
+    }
+
+    void fill_empty() {
+        for (size_type index = 0; index != size(); ++index) {
+            set_empty(index);
+        }
+    }
+
+    size_type next_index(size_type index) const {
+        return (index + 1) & (size() - 1);
+    }
+
+    entry_vector _entries;
+};
+
+} // namespace detail
+
+// names the key which marks the free slots of a sentinel_storage dict, e.g.
+// empty_key<std::uint64_t, ~std::uint64_t(0)> or empty_key<T*, nullptr>
+template <typename Key, Key Empty>
+struct empty_key {
+    static constexpr Key value() { return Empty; }
+};
+
+// free slots hold EmptyKey::value(), which can't be inserted, and entries
+// carry no occupancy at all
+template <typename EmptyKey>
+struct sentinel_storage {
+    template <typename Entry, typename Allocator>
+    using table = detail::sentinel_table<Entry, Allocator, EmptyKey>;
+};
+
+} // namespace io
+
+#endif
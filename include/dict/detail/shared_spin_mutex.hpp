@@ -0,0 +1,95 @@
+#ifndef DICT_SHARED_SPIN_MUTEX_HPP
+#define DICT_SHARED_SPIN_MUTEX_HPP
+
+#include <atomic>
+#include <thread>
+
+namespace io {
+
+namespace detail {
+
+// A reader/writer spin lock meeting the Lockable and SharedLockable
+// requirements, std::shared_mutex is C++17. The top bit marks a writer and the
+// rest counts readers. A waiting writer keeps new readers out so it can't be
+// starved.
+class shared_spin_mutex {
+    static constexpr unsigned writer() { return ~(~0u >> 1); }
+
+public:
+    shared_spin_mutex() : _state(0) {}
+
+    shared_spin_mutex(const shared_spin_mutex&) = delete;
+    shared_spin_mutex& operator=(const shared_spin_mutex&) = delete;
+
+    void lock() {
+        auto state = _state.load(std::memory_order_relaxed);
+        while ((state & writer()) ||
+               !_state.compare_exchange_weak(state, state | writer(),
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            std::this_thread::yield();
+            state = _state.load(std::memory_order_relaxed);
+        }
+
+        // wait for the readers which got in before us to leave
+        while (_state.load(std::memory_order_acquire) != writer()) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool try_lock() {
+        auto state = 0u;
+        return _state.compare_exchange_strong(state, writer(),
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+
+    void unlock() { _state.fetch_and(~writer(), std::memory_order_release); }
+
+    void lock_shared() {
+        while (!try_lock_shared()) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool try_lock_shared() {
+        if (_state.load(std::memory_order_relaxed) & writer()) {
+            return false;
+        }
+
+        if (_state.fetch_add(1, std::memory_order_acquire) & writer()) {
+            _state.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        return true;
+    }
+
+    void unlock_shared() { _state.fetch_sub(1, std::memory_order_release); }
+
+private:
+    std::atomic<unsigned> _state;
+};
+
+// std::shared_lock is C++14
+template <typename Mutex>
+class shared_lock_guard {
+public:
+    explicit shared_lock_guard(Mutex& mutex) : _mutex(mutex) {
+        _mutex.lock_shared();
+    }
+
+    shared_lock_guard(const shared_lock_guard&) = delete;
+    shared_lock_guard& operator=(const shared_lock_guard&) = delete;
+
+    ~shared_lock_guard() { _mutex.unlock_shared(); }
+
+private:
+    Mutex& _mutex;
+};
+
+} // namespace detail
+
+} // namespace io
+
+#endif
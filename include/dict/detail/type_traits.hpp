@@ -0,0 +1,36 @@
+#ifndef DICT_TYPE_TRAITS_HPP
+#define DICT_TYPE_TRAITS_HPP
+
+#include <type_traits>
+
+namespace io {
+
+namespace detail {
+
+template <typename...>
+struct make_void {
+    using type = void;
+};
+
+template <typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+
+template <typename T, typename = void>
+struct has_is_transparent : std::false_type {};
+
+template <typename T>
+struct has_is_transparent<T, void_t<typename T::is_transparent>>
+    : std::true_type {};
+
+// K can be looked up directly if both hasher and key_equal are transparent,
+// K is only there to make the result dependent for SFINAE
+template <typename Hasher, typename KeyEqual, typename K>
+struct is_transparent_key
+    : std::integral_constant<bool, has_is_transparent<Hasher>::value &&
+                                       has_is_transparent<KeyEqual>::value> {};
+
+} // namespace detail
+
+} // namespace io
+
+#endif
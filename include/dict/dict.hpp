@@ -1,25 +1,65 @@
 #ifndef DICT_HPP
 #define DICT_HPP
 
+#include <algorithm>
+#include <exception>
 #include <functional>
+#include <future>
+#include <iterator>
 #include <stdexcept>
 #include <tuple>
 #include <vector>
-#if __cpp_lib_memory_resource
-#include <experimental/memory_resource>
+#if defined(__has_include)
+#if __cplusplus >= 201703L && __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #endif
 
+#include "detail/bitmap_table.hpp"
+#include "detail/control_byte_table.hpp"
 #include "detail/entry.hpp"
+#include "detail/flag_table.hpp"
+#include "detail/hashed_key.hpp"
 #include "detail/iterator.hpp"
 #include "detail/key_value.hpp"
 #include "detail/math_util.hpp"
+#include "detail/node_table.hpp"
+#include "detail/robin_hood_table.hpp"
+#include "detail/sentinel_table.hpp"
+#include "detail/type_traits.hpp"
 
 namespace io {
 
+namespace detail {
+struct dict_file;
+} // namespace detail
+
+// What dict::stats() found in one scan of the table, meant for exporting to
+// a metrics system when lookups get slower.
+struct dict_stats {
+    // slots from the home slot up to a present key
+    double average_hit_probe = 0;
+    std::size_t max_hit_probe = 0;
+    // slots from a home slot up to and including the first free one, over
+    // all home slots
+    double average_miss_probe = 0;
+    std::size_t max_miss_probe = 0;
+    // displacements[d] elements sit d slots after the slot they hash to
+    std::vector<std::size_t> displacements;
+    // the longest run of used slots
+    std::size_t longest_cluster = 0;
+    // what the tables allocated against size() * sizeof(value_type)
+    std::size_t allocated_bytes = 0;
+    std::size_t payload_bytes = 0;
+    // tables grown into, by reserve(), rehash() and inserts
+    std::size_t rehashes = 0;
+};
+
 // container
 template <typename Key, typename Value, typename Hasher = std::hash<Key>,
           typename KeyEqual = std::equal_to<Key>,
-          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+          typename Allocator = std::allocator<std::pair<const Key, Value>>,
+          typename Storage = inline_flag_storage>
 class dict {
 public:
     using key_type = Key;
@@ -31,31 +71,56 @@ public:
     using value_type = std::pair<const Key, Value>;
 
 private:
-    using entry_type = detail::dict_entry<Key, Value>;
-    using _internal_allocator =
-        typename std::allocator_traits<Allocator>::template rebind_alloc<
-        entry_type>;
-    using table_type = std::vector<entry_type, _internal_allocator>;
+    using entry_type =
+        detail::dict_entry<Key, Value, cache_hash<Key, Hasher>::value>;
+    using table_type =
+        typename Storage::template table<entry_type, Allocator>;
 
 public:
     using size_type = typename table_type::size_type;
     using difference_type = typename table_type::difference_type;
     using reference = value_type&;
 
-    using iterator = detail::dict_iterator<Key, Value>;
-    using const_iterator = detail::const_dict_iterator<Key, Value>;
+    using iterator = detail::dict_iterator<typename table_type::view>;
+    using const_iterator =
+        detail::const_dict_iterator<typename table_type::view>;
+
+private:
+    // enables overloads taking any K if Hasher and KeyEqual are transparent
+    template <typename K, typename R>
+    using if_transparent = typename std::enable_if<
+        detail::is_transparent_key<Hasher, KeyEqual, K>::value &&
+            !detail::is_hashed_key<K>::value,
+        R>::type;
+
+    // like if_transparent but also rules out keys which are Key itself or
+    // iterators, so overloads taking K&& don't steal calls from the others
+    template <typename K, typename R>
+    using if_transparent_key = typename std::enable_if<
+        detail::is_transparent_key<Hasher, KeyEqual, K>::value &&
+            !std::is_same<typename std::decay<K>::type, Key>::value &&
+            !std::is_convertible<K, const_iterator>::value &&
+            !detail::is_hashed_key<typename std::decay<K>::type>::value,
+        R>::type;
+
+    // enables the hashed_key<K> overloads for Key and transparent keys
+    template <typename K, typename R>
+    using if_lookup_key = typename std::enable_if<
+        std::is_same<K, Key>::value ||
+            detail::is_transparent_key<Hasher, KeyEqual, K>::value,
+        R>::type;
+
+public:
 
     dict() : dict(initial_size()) {}
 
     explicit dict(size_type initial_size, const Hasher& hash = Hasher(),
                   const KeyEqual& key_equal = KeyEqual(),
                   const Allocator& alloc = Allocator())
-        : _table(_internal_allocator(alloc)), _element_count(0),
-          _max_element_count(initial_size), _hasher(hash),
+        : _table(alloc), _old_table(alloc), _element_count(0),
+          _max_element_count(initial_size), _rehash_step(0), _rehash_index(0),
+          _rehash_left(0), _rehash_count(0), _hasher(hash),
           _key_equal(key_equal) {
-        // we need to do this manually because only as of C++14 there is
-        // explicit vector( size_type count, const Allocator& alloc =
-        // Allocator() );
         _table.resize(next_size(initial_size, initial_load_factor()));
         _max_element_count = initial_load_factor() * _table.size();
     }
@@ -63,14 +128,14 @@ public:
     explicit dict(const Allocator& alloc)
         : dict(initial_size(), Hasher(), KeyEqual(), alloc) {}
 
+    // size_hint is the number of elements to make room for, ranges of
+    // forward iterators reserve for all their elements anyway
     template <typename Iter>
-    dict(Iter begin, Iter end, size_type /* dummy_initial_size */ = 0,
+    dict(Iter begin, Iter end, size_type size_hint = 0,
          const Hasher& hash = Hasher(), const KeyEqual& key_equal = KeyEqual(),
          const Allocator& alloc = Allocator())
-        : dict(initial_size(), hash, key_equal, alloc) {
-        for (auto iter = begin; iter != end; ++iter) {
-            emplace(iter->first, iter->second);
-        }
+        : dict(std::max(size_hint, initial_size()), hash, key_equal, alloc) {
+        insert(begin, end);
     }
 
     template <typename Iter>
@@ -82,45 +147,43 @@ public:
          const Allocator& alloc)
         : dict(begin, end, initial_size, hasher, KeyEqual(), alloc) {}
 
-    dict(std::initializer_list<value_type> init,
-         size_type /* dummy_initial_size */ = 0, const Hasher& hash = Hasher(),
-         const KeyEqual& key_equal = KeyEqual(),
+    dict(std::initializer_list<value_type> init, size_type size_hint = 0,
+         const Hasher& hash = Hasher(), const KeyEqual& key_equal = KeyEqual(),
          const Allocator& alloc = Allocator())
-        : dict(init.begin(), init.end(), initial_size(), hash, key_equal,
-               alloc) {}
+        : dict(init.begin(), init.end(), size_hint, hash, key_equal, alloc) {}
 
-    dict(std::initializer_list<value_type> init, size_type initial_size,
+    dict(std::initializer_list<value_type> init, size_type size_hint,
          const Allocator& alloc)
-        : dict(init.begin(), init.end(), initial_size(), Hasher(), KeyEqual(),
+        : dict(init.begin(), init.end(), size_hint, Hasher(), KeyEqual(),
                alloc) {}
 
-    dict(std::initializer_list<value_type> init, size_type initial_size,
+    dict(std::initializer_list<value_type> init, size_type size_hint,
          const Hasher& hasher, const Allocator& alloc)
-        : dict(init.begin(), init.end(), initial_size(), hasher, KeyEqual(),
+        : dict(init.begin(), init.end(), size_hint, hasher, KeyEqual(),
                alloc) {}
 
     allocator_type get_allocator() const noexcept {
-        return _table.get_allocator();
+        return allocator_type(_table.get_allocator());
     }
 
-    iterator begin() noexcept { return { _table.begin(), _table.end() }; }
+    iterator begin() noexcept { return { _old_table.as_view(), _table.as_view(), 0 }; }
 
     const_iterator begin() const noexcept {
-        return { _table.begin(), _table.end() };
+        return { _old_table.as_view(), _table.as_view(), 0 };
     }
 
     const_iterator cbegin() const noexcept {
-        return { _table.begin(), _table.end() };
+        return { _old_table.as_view(), _table.as_view(), 0 };
     }
 
-    iterator end() noexcept { return { _table.end(), _table.end(), true }; }
+    iterator end() noexcept { return { _table.as_view(), _table.size(), true }; }
 
     const_iterator end() const noexcept {
-        return { _table.end(), _table.end(), true };
+        return { _table.as_view(), _table.size(), true };
     }
 
     const_iterator cend() const noexcept {
-        return { _table.end(), _table.end(), true };
+        return { _table.as_view(), _table.size(), true };
     }
 
     size_type size() const noexcept { return _element_count; }
@@ -129,12 +192,25 @@ public:
 
     // size_type max_size() const {}
 
+    // keeps the table, only the used slots and the occupancy are reset
     void clear() {
-        // this could optimized to not re-default init everything
-        auto old_size = _table.size();
         _table.clear();
-        _table.resize(old_size);
+        drop_old_table();
+        _element_count = 0;
+    }
+
+    // Like clear() but gives the table back and starts over with one sized
+    // for size_hint elements. The max load factor is kept.
+    void clear_and_shrink(size_type size_hint = 0) {
+        auto load_factor = max_load_factor();
+        table_type new_table(get_allocator());
+        new_table.resize(
+            next_size(std::max(size_hint, initial_size()), load_factor));
+
+        _table.swap(new_table);
+        drop_old_table();
         _element_count = 0;
+        max_load_factor(load_factor);
     }
 
     template <typename... Args>
@@ -149,12 +225,13 @@ public:
 
     template <typename... Args>
     std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
-        return insert_element(key, std::forward<Args>(args)...);
+        return insert_element(_hasher(key), key, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
-        return insert_element(std::move(key), std::forward<Args>(args)...);
+        return insert_element(_hasher(key), std::move(key),
+                              std::forward<Args>(args)...);
     }
 
     template <typename... Args>
@@ -169,8 +246,30 @@ public:
         return try_emplace(std::move(key), std::forward<Args>(args)...).first;
     }
 
+    // only constructs a Key from K if the element is inserted
+    template <typename K, typename... Args>
+    if_transparent_key<K, std::pair<iterator, bool>>
+    try_emplace(K&& key, Args&&... args) {
+        return insert_element(_hasher(key), std::forward<K>(key),
+                              std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename... Args>
+    if_lookup_key<K, std::pair<iterator, bool>>
+    try_emplace(const hashed_key<K>& key, Args&&... args) {
+        return insert_element(key.hash(), key.key(),
+                              std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename... Args>
+    if_transparent_key<K, iterator> try_emplace(const_iterator /* hint */,
+                                                K&& key, Args&&... args) {
+        return try_emplace(std::forward<K>(key), std::forward<Args>(args)...)
+            .first;
+    }
+
     std::pair<iterator, bool> insert(const value_type& obj) {
-        return insert_element(obj.first, obj.second);
+        return insert_element(_hasher(obj.first), obj.first, obj.second);
     }
 
     template <typename P,
@@ -188,13 +287,21 @@ public:
     template <typename Mapped>
     std::pair<iterator, bool> insert_or_assign(const key_type& key,
                                                Mapped&& mapped) {
-        return insert_assign_element(key, std::forward<Mapped>(mapped));
+        return insert_assign_element(_hasher(key), key,
+                                     std::forward<Mapped>(mapped));
     }
 
     template <typename Mapped>
     std::pair<iterator, bool> insert_or_assign(key_type&& key,
                                                Mapped&& mapped) {
-        return insert_assign_element(std::move(key),
+        return insert_assign_element(_hasher(key), std::move(key),
+                                     std::forward<Mapped>(mapped));
+    }
+
+    template <typename K, typename Mapped>
+    if_lookup_key<K, std::pair<iterator, bool>>
+    insert_or_assign(const hashed_key<K>& key, Mapped&& mapped) {
+        return insert_assign_element(key.hash(), key.key(),
                                      std::forward<Mapped>(mapped));
     }
 
@@ -219,92 +326,220 @@ public:
 
     template <typename InputIt>
     void insert(InputIt begin, InputIt end) {
-        for (auto iter = begin; iter != end; ++iter) {
-            emplace(iter->first, iter->second);
-        }
+        insert_range(
+            begin, end,
+            typename std::iterator_traits<InputIt>::iterator_category());
     }
 
     void insert(std::initializer_list<value_type> init) {
         insert(init.begin(), init.end());
     }
 
-    void swap(dict<Key, Value, Hasher, KeyEqual, Allocator>& other) {
+    void swap(dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& other) {
         using std::swap;
-        swap(_table, other._table);
+        _table.swap(other._table);
+        _old_table.swap(other._old_table);
         swap(_element_count, other._element_count);
         swap(_max_element_count, other._max_element_count);
+        swap(_rehash_step, other._rehash_step);
+        swap(_rehash_index, other._rehash_index);
+        swap(_rehash_left, other._rehash_left);
+        swap(_rehash_count, other._rehash_count);
         swap(_key_equal, other._key_equal);
         swap(_hasher, other._hasher);
     }
 
-    iterator find(const Key& key) {
-        auto index = find_index(key);
+    iterator find(const Key& key) { return find_impl(key, _hasher(key)); }
 
-        if (_table[index].used) {
-            return iterator_from_index(index);
-        } else {
-            return end();
-        }
+    const_iterator find(const Key& key) const {
+        return find_impl(key, _hasher(key));
     }
 
-    const_iterator find(const Key& key) const {
-        auto index = find_index(key);
+    Value& at(const Key& key) { return at_impl(key); }
 
-        if (_table[index].used) {
-            return iterator_from_index(index);
-        } else {
-            return end();
-        }
+    const Value& at(const Key& key) const { return at_impl(key); }
+
+    size_type count(const Key& key) const { return find(key) == end() ? 0 : 1; }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        return { find(key), end() };
+    }
+
+    std::pair<const_iterator, const_iterator>
+    equal_range(const Key& key) const {
+        return { find(key), end() };
     }
 
-    Value& at(const Key& key) {
-        auto index = find_index(key);
+    // Hashes key for the hashed_key overloads of find, try_emplace,
+    // insert_or_assign, operator[] and erase, so a key looked up repeatedly
+    // or in several dicts is only hashed once.
+    hashed_key<Key> prehash(const Key& key) const {
+        return { key, _hasher(key) };
+    }
 
-        if (_table[index].used) {
-            return _table[index].kv.view.second;
-        }
+    // the token only references the key, so temporaries would dangle
+    hashed_key<Key> prehash(Key&& key) const = delete;
 
-        throw std::out_of_range("Key not in dict");
+    template <typename K>
+    if_transparent<K, hashed_key<K>> prehash(const K& key) const {
+        return { key, _hasher(key) };
     }
 
-    const Value& at(const Key& key) const {
-        auto index = find_index(key);
+    // pulls in the slots a lookup of key will touch first
+    template <typename K>
+    if_lookup_key<K, void> prefetch(const hashed_key<K>& key) const {
+        _table.prefetch(key.hash());
+    }
 
-        if (_table[index].used) {
-            return _table[index].kv.view.second;
-        }
+    template <typename K>
+    if_lookup_key<K, iterator> find(const hashed_key<K>& key) {
+        return find_impl(key.key(), key.hash());
+    }
 
-        throw std::out_of_range("Key not in dict");
+    template <typename K>
+    if_lookup_key<K, const_iterator> find(const hashed_key<K>& key) const {
+        return find_impl(key.key(), key.hash());
     }
 
-    size_type count(const Key& key) const { return find(key) == end() ? 0 : 1; }
+    template <typename K>
+    if_transparent<K, iterator> find(const K& key) {
+        return find_impl(key, _hasher(key));
+    }
 
-    std::pair<iterator, iterator> equal_range(const Key& key) {
+    template <typename K>
+    if_transparent<K, const_iterator> find(const K& key) const {
+        return find_impl(key, _hasher(key));
+    }
+
+    template <typename K>
+    if_transparent<K, Value&> at(const K& key) {
+        return at_impl(key);
+    }
+
+    template <typename K>
+    if_transparent<K, const Value&> at(const K& key) const {
+        return at_impl(key);
+    }
+
+    template <typename K>
+    if_transparent<K, size_type> count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    template <typename K>
+    if_transparent<K, std::pair<iterator, iterator>>
+    equal_range(const K& key) {
         return { find(key), end() };
     }
 
-    std::pair<const_iterator, const_iterator>
-    equal_range(const Key& key) const {
+    template <typename K>
+    if_transparent<K, std::pair<const_iterator, const_iterator>>
+    equal_range(const K& key) const {
         return { find(key), end() };
     }
 
-    Value& operator[](const Key& key) {
-        auto index = find_index(key);
+    // Looks up every key in [first, last) and writes the resulting iterator
+    // (or end()) to out. Keys are hashed and their slots prefetched a batch at
+    // a time before probing, so the cache misses of the lookups overlap.
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+        for_each_batch(first, last, [&](ForwardIt key, std::size_t hash) {
+            *out++ = find_impl(*key, hash);
+        });
+        return out;
+    }
+
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+        for_each_batch(first, last, [&](ForwardIt key, std::size_t hash) {
+            *out++ = find_impl(*key, hash);
+        });
+        return out;
+    }
 
-        if (_table[index].used) {
-            return _table[index].kv.view.second;
-        } else {
-            check_expand();
-            return activate_element(find_index(key), key);
-        }
+    // like find_batch but writes whether each key is in the dict
+    template <typename ForwardIt, typename OutputIt>
+    OutputIt contains_batch(ForwardIt first, ForwardIt last,
+                            OutputIt out) const {
+        for_each_batch(first, last, [&](ForwardIt key, std::size_t hash) {
+            *out++ = find_impl(*key, hash) != end();
+        });
+        return out;
+    }
+
+    Value& operator[](const Key& key) { return subscript(_hasher(key), key); }
+
+    template <typename K>
+    if_transparent_key<K, Value&> operator[](K&& key) {
+        return subscript(_hasher(key), std::forward<K>(key));
+    }
+
+    template <typename K>
+    if_lookup_key<K, Value&> operator[](const hashed_key<K>& key) {
+        return subscript(key.hash(), key.key());
+    }
+
+    size_type erase(const key_type& key) {
+        return erase_impl(key, _hasher(key)).first;
+    }
+
+    template <typename K>
+    if_transparent_key<K, size_type> erase(K&& key) {
+        return erase_impl(key, _hasher(key)).first;
+    }
+
+    template <typename K>
+    if_lookup_key<K, size_type> erase(const hashed_key<K>& key) {
+        return erase_impl(key.key(), key.hash()).first;
+    }
+
+    iterator erase(const_iterator pos) {
+        return erase_impl(pos->first, _hasher(pos->first)).second;
     }
 
-    size_type erase(const key_type& key) { return erase_impl(key).first; }
+    // Erases [first, last) in one pass over its slots, see erase_if. The
+    // returned iterator starts at the slot of first, entries shifted back
+    // into the range are visited again.
+    iterator erase(const_iterator first, const_iterator last) {
+        if (first == last) {
+            return { first._table, first._next, first._index, true };
+        }
+
+        // a range starting in the old table runs to its end unless it also
+        // ends there
+        auto index = first._index;
+        if (in_old_table(first)) {
+            auto old_last =
+                in_old_table(last) ? last._index : _old_table.size();
+            erase_slots(_old_table, index, old_last - index,
+                        [](size_type) { return true; });
+
+            if (!in_old_table(last)) {
+                erase_slots(_table, 0, last._index,
+                            [](size_type) { return true; });
+            }
+
+            return { _old_table.as_view(), _table.as_view(), index };
+        }
+
+        erase_slots(_table, index, last._index - index,
+                    [](size_type) { return true; });
+        return { _table.as_view(), index };
+    }
 
-    iterator erase(const_iterator pos) { return erase_impl(pos->first).second; }
+    // Erases all elements for which pred(element) is true and returns how
+    // many. Instead of shifting a cluster back for every erased element the
+    // slots are swept once and each remaining entry moves straight to the
+    // first free slot from its home on, so every cluster is compacted once.
+    template <typename Predicate>
+    size_type erase_if(Predicate pred) {
+        size_type erased = 0;
+        if (rehashing()) {
+            erased += erase_matching(_old_table, pred);
+        }
 
-    // we don't support this (yet?)
-    // iterator erase(const_iterator first, const_iterator last) {}
+        return erased + erase_matching(_table, pred);
+    }
 
     float load_factor() const { return _element_count / float(_table.size()); }
 
@@ -325,21 +560,28 @@ public:
         }
     }
 
-    void reserve(std::size_t new_size) {
-        if (new_size > _table.size()) {
-            table_type new_table(_table.get_allocator());
+    void reserve(std::size_t new_size) { reserve(new_size, 1); }
+
+    // Like reserve(new_size) but moves the entries with up to the given
+    // number of threads, meant for rebuilding very large tables. Small tables
+    // are always moved by the calling thread.
+    void reserve(std::size_t new_size, std::size_t threads) {
+        finish_rehash();
+
+        if (new_size > _max_element_count) {
+            table_type new_table(get_allocator());
             new_table.resize(next_size(new_size, max_load_factor()));
 
-            for (auto&& e : _table) {
-                if (e.used) {
-                    auto new_index =
-                        find_index_impl(e.kv.view.first, new_table);
-                    new_table[new_index] = std::move_if_noexcept(e);
-                }
+            threads = std::min(threads, _table.size() / min_slots_per_thread());
+            if (threads > 1) {
+                move_entries(new_table, threads);
+            } else {
+                move_entries(new_table);
             }
 
             _max_element_count = max_load_factor() * new_table.size();
             _table.swap(new_table);
+            ++_rehash_count;
         }
     }
 
@@ -349,99 +591,511 @@ public:
 
     bool next_is_rehash() const { return size() >= _max_element_count; }
 
+    // Number of old slots every insert moves to the new table after the dict
+    // grew. With the default of 0 the insert that crosses the load factor
+    // moves all entries at once, otherwise the old and the new table coexist
+    // until the move is done and lookups check both.
+    size_type rehash_step() const noexcept { return _rehash_step; }
+
+    void rehash_step(size_type slots) {
+        _rehash_step = slots;
+
+        if (!_rehash_step) {
+            finish_rehash();
+        }
+    }
+
+    // whether entries are still waiting to be moved to the new table
+    bool rehashing() const noexcept { return _old_table.size() != 0; }
+
+    // Scans the table once. Probe lengths count slots from the home slot,
+    // not probe steps or key compares: control byte and node storage check
+    // a whole group of control bytes per step and only compare keys whose
+    // fingerprint matches. Clusters are counted from a free slot on, the
+    // table is never full, and a miss from a home slot inside a cluster of
+    // length n at position k passes n - k + 1 slots. Robin hood storage stops
+    // misses earlier than that. Entries still waiting in the old table of an
+    // incremental rehash are left out of the probe numbers, its memory isn't.
+    dict_stats stats() const {
+        dict_stats stats;
+        const auto slots = _table.size();
+
+        std::size_t hits = 0;
+        std::size_t hit_probes = 0;
+        for (auto index = _table.next_used(0); index != slots;
+             index = _table.next_used(index + 1)) {
+            auto displacement =
+                (index - _table.home_index(index, _hasher)) & (slots - 1);
+            if (displacement >= stats.displacements.size()) {
+                stats.displacements.resize(displacement + 1);
+            }
+            ++stats.displacements[displacement];
+
+            ++hits;
+            hit_probes += displacement + 1;
+            stats.max_hit_probe =
+                std::max<std::size_t>(stats.max_hit_probe, displacement + 1);
+        }
+
+        // each cluster and the free slot after it add 2 + ... + (n + 1)
+        // and 1
+        std::size_t miss_probes = 0;
+        size_type start = 0;
+        while (_table.used(start)) {
+            ++start;
+        }
+        std::size_t cluster = 0;
+        for (size_type i = 1; i <= slots; ++i) {
+            if (_table.used((start + i) & (slots - 1))) {
+                ++cluster;
+                continue;
+            }
+
+            miss_probes += (cluster + 1) * (cluster + 2) / 2;
+            stats.longest_cluster = std::max(stats.longest_cluster, cluster);
+            cluster = 0;
+        }
+
+        stats.max_miss_probe = stats.longest_cluster + 1;
+        stats.average_hit_probe = hits ? double(hit_probes) / hits : 0;
+        stats.average_miss_probe = double(miss_probes) / slots;
+        stats.allocated_bytes =
+            _table.allocated_bytes() + _old_table.allocated_bytes();
+        stats.payload_bytes = _element_count * sizeof(value_type);
+        stats.rehashes = _rehash_count;
+        return stats;
+    }
+
     hasher hash_function() const { return _hasher; }
 
     key_equal key_eq() const { return _key_equal; }
 
 private:
-    void check_expand() {
+    bool check_expand() {
         if (next_is_rehash()) {
-            rehash();
+            if (_rehash_step) {
+                start_rehash();
+            } else {
+                rehash();
+            }
+
+            return true;
         }
+
+        return false;
+    }
+
+    // makes room for one more element, returns whether entries were moved
+    // and thus the slot found before has to be looked up again
+    bool prepare_insert() {
+        auto expanded = check_expand();
+        return migrate(_rehash_step) || expanded;
+    }
+
+    // swaps in a table twice the size and leaves the entries in _old_table,
+    // from where every insert moves _rehash_step slots
+    void start_rehash() {
+        finish_rehash();
+
+        table_type new_table(get_allocator());
+        new_table.resize(next_size(_table.size() + 1, max_load_factor()));
+        _max_element_count = max_load_factor() * new_table.size();
+        _old_table.swap(_table);
+        _table.swap(new_table);
+        ++_rehash_count;
+
+        // start at an empty slot so no cluster wraps around the start, the
+        // table is never full
+        _rehash_index = 0;
+        while (_old_table.used(_rehash_index)) {
+            ++_rehash_index;
+        }
+
+        _rehash_left = _old_table.size();
+    }
+
+    // Moves at least the given number of slots from _old_table to _table.
+    // The current cluster is always moved completely, otherwise entries
+    // remaining in it could no longer be found in _old_table.
+    bool migrate(size_type slots) {
+        if (!rehashing()) {
+            return false;
+        }
+
+        const auto mask = _old_table.size() - 1;
+        while (_rehash_left != 0 &&
+               (slots != 0 || _old_table.used(_rehash_index))) {
+            if (_old_table.used(_rehash_index)) {
+                auto hash = _old_table[_rehash_index].hash(_hasher);
+                _table.construct(_table.find_slot(hash), hash,
+                                 _old_table.take(_rehash_index));
+                _old_table.destroy(_rehash_index);
+            }
+
+            _rehash_index = (_rehash_index + 1) & mask;
+            --_rehash_left;
+            slots -= slots != 0;
+        }
+
+        if (!_rehash_left) {
+            drop_old_table();
+        }
+
+        return true;
+    }
+
+    void finish_rehash() { migrate(_rehash_left); }
+
+    void move_entries(table_type& new_table) {
+        for (auto index = _table.next_used(0); index != _table.size();
+             index = _table.next_used(index + 1)) {
+            auto hash = _table[index].hash(_hasher);
+            new_table.construct(new_table.find_slot(hash), hash,
+                                _table.take(index));
+        }
+    }
+
+    // old slots whose entries couldn't be placed in parallel and their hash
+    using deferred_entries = std::vector<std::pair<size_type, std::size_t>>;
+
+    // Every thread takes a range of old slots which starts and ends at an
+    // empty slot, so it holds whole clusters and all entries in it have their
+    // home in it. The new table is a power of two multiple of the old one, so
+    // these entries hash to slots congruent to the range modulo the old size
+    // and the threads own disjoint parts of the new table. Entries which would
+    // probe out of their part are placed afterwards by the calling thread.
+    void move_entries(table_type& new_table, std::size_t threads) {
+        const auto old_size = _table.size();
+
+        std::vector<size_type> bounds(threads + 1);
+        for (std::size_t thread = 0; thread != threads; ++thread) {
+            auto bound = thread * old_size / threads;
+            if (thread != 0) {
+                bound = std::max(bound, bounds[thread - 1]);
+            }
+
+            // bounds[0] + old_size is empty, so this stops before it
+            while (_table.used(bound & (old_size - 1))) {
+                ++bound;
+            }
+
+            bounds[thread] = bound;
+        }
+        bounds[threads] = bounds[0] + old_size;
+
+        std::vector<std::future<deferred_entries>> workers;
+        for (std::size_t thread = 0; thread != threads; ++thread) {
+            workers.push_back(std::async(
+                std::launch::async, [this, &new_table, &bounds, thread] {
+                    return move_range(new_table, bounds[thread],
+                                      bounds[thread + 1]);
+                }));
+        }
+
+        std::vector<deferred_entries> deferred;
+        for (auto& worker : workers) {
+            deferred.push_back(worker.get());
+        }
+
+        for (const auto& entries : deferred) {
+            for (const auto& entry : entries) {
+                new_table.construct(new_table.find_slot(entry.second),
+                                    entry.second, _table.take(entry.first));
+            }
+        }
+    }
+
+    // moves the entries of the old slots [first, last), both may lie beyond
+    // the end of the old table in which case they wrap around
+    deferred_entries move_range(table_type& new_table, size_type first,
+                                size_type last) {
+        const auto old_mask = _table.size() - 1;
+        const auto new_size = new_table.size();
+        // owned parts are shrunk to whole blocks so that threads never write
+        // to the same bitmap word or cache line
+        const auto block = size_type(64);
+
+        deferred_entries deferred;
+        for (auto slot = first; slot != last; ++slot) {
+            auto index = slot & old_mask;
+            if (!_table.used(index)) {
+                continue;
+            }
+
+            auto hash = _table[index].hash(_hasher);
+            auto home = hash & (new_size - 1);
+
+            // the part of the new table around home owned by this thread,
+            // wrapping at the start of the new table if necessary
+            auto begin = home - ((home - first) & old_mask);
+            auto end = std::min(begin + (last - first), new_size);
+            begin = begin > home ? 0 : begin;
+
+            auto aligned_begin = (begin + block - 1) & ~(block - 1);
+            auto aligned_end = end & ~(block - 1);
+
+            if (home < aligned_begin ||
+                !new_table.construct_before(aligned_end, hash,
+                                            _table.take(index))) {
+                deferred.emplace_back(index, hash);
+            }
+        }
+
+        return deferred;
+    }
+
+    // tables smaller than this per thread are moved without extra threads
+    static constexpr size_type min_slots_per_thread() { return 1 << 12; }
+
+    template <typename InputIt>
+    void insert_range(InputIt begin, InputIt end, std::input_iterator_tag) {
+        for (auto iter = begin; iter != end; ++iter) {
+            insert_element(_hasher(iter->first), iter->first, iter->second);
+        }
+    }
+
+    // reserves for the whole range up front instead of growing while
+    // inserting
+    template <typename ForwardIt>
+    void insert_range(ForwardIt begin, ForwardIt end,
+                      std::forward_iterator_tag) {
+        reserve(size() + static_cast<size_type>(std::distance(begin, end)));
+        insert_range(begin, end, std::input_iterator_tag());
+    }
+
+    void drop_old_table() {
+        table_type(get_allocator()).swap(_old_table);
+        _rehash_index = 0;
+        _rehash_left = 0;
     }
 
     // insert by variadic arg pack (including key)
     template <typename... Args>
     std::pair<iterator, bool> insert_entry(Args&&... args) {
-        check_expand();
         auto new_entry = make_entry(std::forward<Args>(args)...);
-        auto index = find_index(new_entry.kv.view.first);
+        auto hash = _hasher(new_entry.key());
+        auto index = find_index(new_entry.key(), hash);
+
+        if (index.second) {
+            return { iterator_from_index(index.first), false };
+        }
 
-        if (_table[index].used) {
-            return { iterator_from_index(index), false };
-        } else {
-            _table[index] = std::move(new_entry);
-            ++_element_count;
-            return { iterator_from_index(index), true };
+        auto old_index = find_old_index(new_entry.key(), hash);
+        if (old_index.second) {
+            return { old_iterator_from_index(old_index.first), false };
         }
+
+        if (prepare_insert()) {
+            index.first = _table.find_slot(hash);
+        }
+
+        _table.construct(index.first, hash, std::move(new_entry));
+        ++_element_count;
+        return { iterator_from_index(index.first), true };
     }
 
-    // insert by key + mapped value
-    template <typename KeyParam, typename Mapped>
-    std::pair<iterator, bool> insert_element(KeyParam&& key, Mapped&& mapped) {
-        check_expand();
-        auto index = find_index(key);
+    // insert by key + args for the mapped value
+    template <typename KeyParam, typename... Args>
+    std::pair<iterator, bool> insert_element(std::size_t hash, KeyParam&& key,
+                                             Args&&... args) {
+        auto index = find_index(key, hash);
+
+        if (index.second) {
+            return { iterator_from_index(index.first), false };
+        }
+
+        auto old_index = find_old_index(key, hash);
+        if (old_index.second) {
+            return { old_iterator_from_index(old_index.first), false };
+        }
 
-        if (_table[index].used) {
-            return { iterator_from_index(index), false };
-        } else {
-            _table[index] = make_entry(std::forward<KeyParam>(key),
-                                       std::forward<Mapped>(mapped));
-            ++_element_count;
-            return { iterator_from_index(index), true };
+        if (prepare_insert()) {
+            index.first = _table.find_slot(hash);
         }
+
+        _table.construct(
+            index.first, hash,
+            make_entry(std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<KeyParam>(key)),
+                       std::forward_as_tuple(std::forward<Args>(args)...)));
+        ++_element_count;
+        return { iterator_from_index(index.first), true };
     }
 
     // insert or overwrite by key + mapped value
     template <typename KeyParam, typename Mapped>
-    std::pair<iterator, bool> insert_assign_element(KeyParam&& key,
+    std::pair<iterator, bool> insert_assign_element(std::size_t hash,
+                                                    KeyParam&& key,
                                                     Mapped&& mapped) {
-        check_expand();
-        auto index = find_index(key);
+        auto index = find_index(key, hash);
 
-        if (_table[index].used) {
-            _table[index].kv.view.second = std::forward<Mapped>(mapped);
-            return { iterator_from_index(index), false };
-        } else {
-            _table[index] = make_entry(std::forward<KeyParam>(key),
-                                       std::forward<Mapped>(mapped));
-            ++_element_count;
-            return { iterator_from_index(index), true };
+        if (index.second) {
+            _table[index.first].kv.view.second = std::forward<Mapped>(mapped);
+            return { iterator_from_index(index.first), false };
         }
+
+        auto old_index = find_old_index(key, hash);
+        if (old_index.second) {
+            _old_table[old_index.first].kv.view.second =
+                std::forward<Mapped>(mapped);
+            return { old_iterator_from_index(old_index.first), false };
+        }
+
+        if (prepare_insert()) {
+            index.first = _table.find_slot(hash);
+        }
+
+        _table.construct(index.first, hash,
+                         make_entry(std::forward<KeyParam>(key),
+                                    std::forward<Mapped>(mapped)));
+        ++_element_count;
+        return { iterator_from_index(index.first), true };
+    }
+
+    template <typename KeyParam>
+    Value& subscript(std::size_t hash, KeyParam&& key) {
+        auto index = find_index(key, hash);
+
+        if (index.second) {
+            return _table[index.first].kv.view.second;
+        }
+
+        auto old_index = find_old_index(key, hash);
+        if (old_index.second) {
+            return _old_table[old_index.first].kv.view.second;
+        }
+
+        if (prepare_insert()) {
+            index.first = _table.find_slot(hash);
+        }
+
+        return activate_element(index.first, hash, std::forward<KeyParam>(key));
     }
 
     // marks element at given index as in the map
-    Value& activate_element(size_type index, const Key& key) {
-        _table[index].used = true;
-        _table[index].kv.view.first = key;
+    template <typename KeyParam>
+    Value& activate_element(size_type index, std::size_t hash,
+                            KeyParam&& key) {
+        _table.construct(
+            index, hash,
+            make_entry(std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<KeyParam>(key)),
+                       std::tuple<>()));
         ++_element_count;
 
         return _table[index].kv.view.second;
     }
 
-    std::pair<size_type, iterator> erase_impl(const Key& key) {
-        auto index = find_index(key);
+    template <typename K>
+    std::pair<size_type, iterator> erase_impl(const K& key, std::size_t hash) {
+        auto found = find_index(key, hash);
+
+        if (found.second) {
+            erase_index(_table, found.first);
+            return { 1, { _table.as_view(), found.first } };
+        }
+
+        // the backward shift stays within the cluster, so erasing from the
+        // old table doesn't get in the way of the migration
+        auto old_found = find_old_index(key, hash);
+        if (old_found.second) {
+            erase_index(_old_table, old_found.first);
+            return { 1, { _old_table.as_view(), _table.as_view(), old_found.first } };
+        }
+
+        return { 0, {} };
+    }
+
+    template <typename Predicate>
+    size_type erase_matching(table_type& table, Predicate& pred) {
+        // starting at an empty slot no cluster wraps around the start
+        size_type first = 0;
+        while (table.used(first)) {
+            ++first;
+        }
+
+        return erase_slots(table, first, table.size(), [&](size_type index) {
+            return pred(table[index].kv.const_view);
+        });
+    }
+
+    // Erases the entries in the count slots from first on for which
+    // should_erase(index) is true and moves the remaining ones back over the
+    // freed slots, continuing behind the range until the last touched
+    // cluster ends. If should_erase throws the current cluster is still
+    // compacted before the exception is passed on.
+    template <typename ShouldErase>
+    size_type erase_slots(table_type& table, size_type first, size_type count,
+                          ShouldErase should_erase) {
+        const auto mask = table.size() - 1;
+        size_type erased = 0;
+        // whether the current cluster has free slots entries can move back to
+        bool holes = false;
+        std::exception_ptr error;
+
+        auto index = first;
+        for (size_type visited = 0;
+             visited < count || (holes && table.used(index));
+             ++visited, index = (index + 1) & mask) {
+            if (!table.used(index)) {
+                holes = false;
+                continue;
+            }
+
+            if (visited < count) {
+                bool erase = false;
+                try {
+                    erase = should_erase(index);
+                } catch (...) {
+                    error = std::current_exception();
+                    count = visited;
+                }
+
+                if (erase) {
+                    table.destroy(index);
+                    ++erased;
+                    holes = true;
+                    continue;
+                }
+            }
+
+            if (!holes) {
+                continue;
+            }
+
+            // the slots from the home on are taken up to the first hole
+            auto slot = table.home_index(index, _hasher);
+            while (slot != index && table.used(slot)) {
+                slot = (slot + 1) & mask;
+            }
+
+            if (slot != index) {
+                table.relocate(index, slot);
+            }
+        }
 
-        if (!_table[index].used) {
-            return { 0, {} };
+        _element_count -= erased;
+        if (error) {
+            std::rethrow_exception(error);
         }
 
-        const auto deleted_index = index;
+        return erased;
+    }
 
-        _table[index] = empty_slot_factory();
+    void erase_index(table_type& table, size_type index) {
+        table.destroy(index);
         --_element_count;
 
+        const auto mask = table.size() - 1;
         auto delete_index = index;
         while (true) {
-            delete_index = next_index(delete_index);
+            delete_index = (delete_index + 1) & mask;
 
-            if (!_table[delete_index].used) {
-                return { 1,
-                         { std::next(_table.begin(), deleted_index),
-                           _table.end() } };
+            if (!table.used(delete_index)) {
+                return;
             }
 
-            auto new_key = hash_index(_table[delete_index].kv.view.first);
+            auto new_key = table.home_index(delete_index, _hasher);
 
             if ((index <= delete_index)
                     ? ((index < new_key) && (new_key <= delete_index))
@@ -449,64 +1103,123 @@ private:
                 continue;
             }
 
-            // swapping previously emptied index with delete_index
-            using std::swap;
-            swap(_table[index], _table[delete_index]);
+            // moving delete_index into the previously emptied index
+            table.relocate(delete_index, index);
             index = delete_index;
         }
     }
 
-    size_type find_index(const Key& key) const {
-        return find_index_impl(key, _table);
+    // returns the index of the key and whether it was found, in case it was
+    // not found the index is the slot the key has to be inserted at
+    template <typename K>
+    std::pair<size_type, bool> find_index(const K& key,
+                                          std::size_t hash) const {
+        return _table.find(key, hash, _key_equal);
     }
 
-    size_type find_index_impl(const Key& key, const table_type& table) const {
-        auto index = hash_index_impl(key, table);
+    // looks for key among the entries which still have to be migrated
+    template <typename K>
+    std::pair<size_type, bool> find_old_index(const K& key,
+                                              std::size_t hash) const {
+        if (!rehashing()) {
+            return { 0, false };
+        }
 
-        while (table[index].used) {
-            if (_key_equal(table[index].kv.view.first, key)) {
-                return index;
-            }
+        return _old_table.find(key, hash, _key_equal);
+    }
 
-            index = next_index_impl(index, table);
+    template <typename K>
+    iterator find_impl(const K& key, std::size_t hash) {
+        auto index = find_index(key, hash);
+        if (index.second) {
+            return iterator_from_index(index.first);
         }
 
-        return index;
+        auto old_index = find_old_index(key, hash);
+        return old_index.second ? old_iterator_from_index(old_index.first)
+                                : end();
     }
 
-    size_type hash_index(const Key& key) const {
-        return hash_index_impl(key, _table);
+    template <typename K>
+    const_iterator find_impl(const K& key, std::size_t hash) const {
+        auto index = find_index(key, hash);
+        if (index.second) {
+            return iterator_from_index(index.first);
+        }
+
+        auto old_index = find_old_index(key, hash);
+        return old_index.second ? old_iterator_from_index(old_index.first)
+                                : end();
     }
 
-    size_type hash_index_impl(const Key& key, const table_type& table) const {
-        return _hasher(key) & (table.size() - 1);
+    template <typename K>
+    Value& at_impl(const K& key) {
+        auto iter = find_impl(key, _hasher(key));
+
+        if (iter != end()) {
+            return iter->second;
+        }
+
+        throw std::out_of_range("Key not in dict");
     }
 
-    constexpr size_type next_index(size_type index) const {
-        return next_index_impl(index, _table);
+    template <typename K>
+    const Value& at_impl(const K& key) const {
+        auto iter = find_impl(key, _hasher(key));
+
+        if (iter != end()) {
+            return iter->second;
+        }
+
+        throw std::out_of_range("Key not in dict");
     }
 
-    constexpr size_type next_index_impl(size_type index,
-                                        const table_type& table) const {
-        return (index + 1) & (table.size() - 1);
+    // number of lookups find_batch keeps in flight
+    static constexpr std::size_t batch_size() { return 16; }
+
+    template <typename ForwardIt, typename Visitor>
+    void for_each_batch(ForwardIt first, ForwardIt last, Visitor visit) const {
+        std::size_t hashes[batch_size()];
+
+        while (first != last) {
+            std::size_t count = 0;
+            for (auto iter = first; iter != last && count != batch_size();
+                 ++iter, ++count) {
+                hashes[count] = _hasher(*iter);
+                _table.prefetch(hashes[count]);
+            }
+
+            for (std::size_t i = 0; i != count; ++i, ++first) {
+                visit(first, hashes[i]);
+            }
+        }
     }
 
     template <typename... Args>
     entry_type make_entry(Args&&... args) const {
-        return { detail::key_value<Key, Value>(std::forward<Args>(args)...),
-                 true };
+        return entry_type(
+            detail::key_value<Key, Value>(std::forward<Args>(args)...));
     }
 
-    entry_type empty_slot_factory() const {
-        return { detail::key_value<Key, Value>(Key(), Value()), false };
+    // iterators hold views, which are told apart by their arrays
+    bool in_old_table(const_iterator pos) const {
+        return rehashing() && pos._table.data() == _old_table.as_view().data();
     }
 
     iterator iterator_from_index(size_type index) {
-        return { std::next(_table.begin(), index), _table.end(), true };
+        return { _table.as_view(), index, true };
     }
 
     const_iterator iterator_from_index(size_type index) const {
-        return { std::next(_table.begin(), index), _table.end(), true };
+        return { _table.as_view(), index, true };
+    }
+
+    iterator old_iterator_from_index(size_type index) {
+        return { _old_table.as_view(), _table.as_view(), index, true };
+    }
+
+    const_iterator old_iterator_from_index(size_type index) const {
+        return { _old_table.as_view(), _table.as_view(), index, true };
     }
 
     size_type initial_size() const { return detail::next_power_of_two(8); }
@@ -518,9 +1231,20 @@ private:
 
     constexpr float initial_load_factor() const { return 0.7; }
 
+    // writes the raw table for mapped_dict
+    friend struct detail::dict_file;
+
     table_type _table;
+    // the previous table while an incremental rehash is in progress
+    table_type _old_table;
     size_type _element_count;
     size_type _max_element_count;
+    size_type _rehash_step;
+    // next slot of _old_table to migrate and how many are left to visit
+    size_type _rehash_index;
+    size_type _rehash_left;
+    // tables grown into since construction, reported by stats()
+    size_type _rehash_count;
     hasher _hasher;
     key_equal _key_equal;
 };
@@ -530,16 +1254,25 @@ private:
 #endif
 
 template <typename Key, typename Value, typename Hasher, typename KeyEqual,
-          typename Allocator>
-void swap(dict<Key, Value, Hasher, KeyEqual, Allocator>& A,
-          dict<Key, Value, Hasher, KeyEqual, Allocator>& B) {
+          typename Allocator, typename Storage>
+void swap(dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& A,
+          dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& B) {
     A.swap(B);
 }
 
 template <typename Key, typename Value, typename Hasher, typename KeyEqual,
-          typename Allocator>
-bool operator==(const dict<Key, Value, Hasher, KeyEqual, Allocator>& A,
-                const dict<Key, Value, Hasher, KeyEqual, Allocator>& B) {
+          typename Allocator, typename Storage, typename Predicate>
+typename dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>::size_type
+erase_if(dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& d,
+         Predicate pred) {
+    return d.erase_if(pred);
+}
+
+template <typename Key, typename Value, typename Hasher, typename KeyEqual,
+          typename Allocator, typename Storage>
+bool operator==(
+    const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& A,
+    const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& B) {
     if (A.size() != B.size()) {
         return false;
     }
@@ -556,20 +1289,26 @@ bool operator==(const dict<Key, Value, Hasher, KeyEqual, Allocator>& A,
 }
 
 template <typename Key, typename Value, typename Hasher, typename KeyEqual,
-          typename Allocator>
-bool operator!=(const dict<Key, Value, Hasher, KeyEqual, Allocator>& A,
-                const dict<Key, Value, Hasher, KeyEqual, Allocator>& B) {
+          typename Allocator, typename Storage>
+bool operator!=(
+    const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& A,
+    const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& B) {
     return !(A == B);
 }
 
 #if __cpp_lib_memory_resource
 
 namespace pmr {
+// tables come from a std::pmr::memory_resource, a dict that grows in a
+// monotonic arena leaves the tables it outgrew there unless a
+// recycling_resource sits in between
 template <typename Key, typename Value, typename Hasher = std::hash<Key>,
-          typename KeyEqual = std::equal_to<Key>>
-using dict = dict<
-    Key, Value, Hasher, KeyEqual,
-    std::experimental::pmr::polymorphic_allocator<std::pair<const Key, Value>>>;
+          typename KeyEqual = std::equal_to<Key>,
+          typename Storage = inline_flag_storage>
+using dict =
+    io::dict<Key, Value, Hasher, KeyEqual,
+             std::pmr::polymorphic_allocator<std::pair<const Key, Value>>,
+             Storage>;
 } // namespace pmr
 
 #endif
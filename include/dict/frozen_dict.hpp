@@ -0,0 +1,291 @@
+#ifndef DICT_FROZEN_DICT_HPP
+#define DICT_FROZEN_DICT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "dict.hpp"
+#include "detail/math_util.hpp"
+
+namespace io {
+
+// An immutable map built once from a dict or a range. The elements are stored
+// densely without any empty slots and a minimal perfect hash maps every key to
+// its own slot, so a lookup hashes, reads one pilot and compares a single key.
+//
+// The perfect hash is PTHash-like: keys are split into buckets of about four
+// by their hash and for every bucket, largest first, a pilot value is searched
+// which sends all its keys to slots not taken yet. A key's slot is picked by
+// the hash mixed with the pilot of its bucket. The few keys sent behind the
+// last element are remapped to the slots left free.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class frozen_dict {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using allocator_type = Allocator;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    using value_type = std::pair<const Key, Value>;
+
+private:
+    using entry_vector = std::vector<value_type, Allocator>;
+    using pilot_allocator = typename std::allocator_traits<
+        Allocator>::template rebind_alloc<std::uint32_t>;
+    using pilot_vector = std::vector<std::uint32_t, pilot_allocator>;
+
+public:
+    using size_type = typename entry_vector::size_type;
+    using difference_type = typename entry_vector::difference_type;
+    using const_reference = const value_type&;
+
+    // elements can't be changed, both iterators are const
+    using iterator = typename entry_vector::const_iterator;
+    using const_iterator = typename entry_vector::const_iterator;
+
+    frozen_dict()
+        : frozen_dict(dict<Key, Value, Hasher, KeyEqual, Allocator>()) {}
+
+    template <typename Storage>
+    explicit frozen_dict(
+        const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& source)
+        : _entries(source.get_allocator()),
+          _pilots(pilot_allocator(source.get_allocator())),
+          _remap(pilot_allocator(source.get_allocator())),
+          _hasher(source.hash_function()), _key_equal(source.key_eq()) {
+        build(source);
+    }
+
+    // later duplicates of a key are ignored, as with dict
+    template <typename Iter>
+    frozen_dict(Iter begin, Iter end, const Hasher& hash = Hasher(),
+                const KeyEqual& key_equal = KeyEqual(),
+                const Allocator& alloc = Allocator())
+        : frozen_dict(dict<Key, Value, Hasher, KeyEqual, Allocator>(
+              begin, end, 0, hash, key_equal, alloc)) {}
+
+    frozen_dict(std::initializer_list<value_type> init,
+                const Hasher& hash = Hasher(),
+                const KeyEqual& key_equal = KeyEqual(),
+                const Allocator& alloc = Allocator())
+        : frozen_dict(init.begin(), init.end(), hash, key_equal, alloc) {}
+
+    allocator_type get_allocator() const { return _entries.get_allocator(); }
+
+    const_iterator begin() const noexcept { return _entries.begin(); }
+
+    const_iterator end() const noexcept { return _entries.end(); }
+
+    const_iterator cbegin() const noexcept { return _entries.begin(); }
+
+    const_iterator cend() const noexcept { return _entries.end(); }
+
+    bool empty() const noexcept { return _entries.empty(); }
+
+    size_type size() const noexcept { return _entries.size(); }
+
+    const_iterator find(const Key& key) const {
+        if (_entries.empty()) {
+            return end();
+        }
+
+        auto index = slot_index(_hasher(key));
+        if (!_key_equal(_entries[index].first, key)) {
+            return end();
+        }
+
+        return begin() + index;
+    }
+
+    size_type count(const Key& key) const { return find(key) == end() ? 0 : 1; }
+
+    const Value& at(const Key& key) const {
+        auto iter = find(key);
+        if (iter == end()) {
+            throw std::out_of_range("Key not in dict");
+        }
+
+        return iter->second;
+    }
+
+    std::pair<const_iterator, const_iterator>
+    equal_range(const Key& key) const {
+        auto iter = find(key);
+        return { iter, iter == end() ? iter : std::next(iter) };
+    }
+
+    hasher hash_function() const { return _hasher; }
+
+    key_equal key_eq() const { return _key_equal; }
+
+private:
+    static constexpr std::uint64_t golden_ratio() {
+        return 0x9e3779b97f4a7c15ull;
+    }
+
+    // keys per bucket, more makes the pilots smaller but the search longer
+    static constexpr size_type average_bucket_size() { return 4; }
+
+    // one extra slot to hash into per this many keys
+    static constexpr size_type extra_slots() { return 32; }
+
+    size_type bucket_index(std::uint64_t mixed) const {
+        return detail::reduce_range(mixed, _pilots.size());
+    }
+
+    size_type slot_index(std::uint64_t mixed, std::uint64_t pilot,
+                         size_type slot_count) const {
+        return detail::reduce_range(
+            (mixed ^ (pilot * golden_ratio())) * golden_ratio(), slot_count);
+    }
+
+    size_type slot_index(std::size_t hash) const {
+        auto mixed = detail::mix_bits(hash);
+        auto index = slot_index(mixed, _pilots[bucket_index(mixed)],
+                                _entries.size() + _remap.size());
+        if (index >= _entries.size()) {
+            return _remap[index - _entries.size()];
+        }
+
+        return index;
+    }
+
+    template <typename Source>
+    void build(const Source& source) {
+        if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("Too many elements for frozen_dict");
+        }
+
+        using key_hash = std::pair<std::uint64_t, const value_type*>;
+        std::vector<key_hash> keys;
+        keys.reserve(source.size());
+        for (const auto& element : source) {
+            keys.emplace_back(detail::mix_bits(_hasher(element.first)),
+                              &element);
+        }
+
+        if (keys.empty()) {
+            return;
+        }
+
+        _pilots.assign(keys.size() / average_bucket_size() + 1, 0);
+
+        // the bucket grows with the hash so this groups the keys by bucket,
+        // keys with the same hash would need the same slot whatever the pilot
+        std::sort(keys.begin(), keys.end(),
+                  [](const key_hash& lhs, const key_hash& rhs) {
+                      return lhs.first < rhs.first;
+                  });
+
+        // (size, first key) of every non empty bucket
+        std::vector<std::pair<size_type, size_type>> buckets;
+        for (size_type first = 0; first != keys.size();) {
+            auto last = first + 1;
+            while (last != keys.size() &&
+                   bucket_index(keys[last].first) ==
+                       bucket_index(keys[first].first)) {
+                if (keys[last].first == keys[last - 1].first) {
+                    throw std::invalid_argument(
+                        "Keys with equal hashes can't be perfectly hashed");
+                }
+                ++last;
+            }
+
+            buckets.emplace_back(last - first, first);
+            first = last;
+        }
+
+        std::sort(buckets.begin(), buckets.end(),
+                  [](const std::pair<size_type, size_type>& lhs,
+                     const std::pair<size_type, size_type>& rhs) {
+                      return lhs.first > rhs.first;
+                  });
+
+        // The pilots hash into a few more slots than there are keys, else
+        // the last buckets need pilot after pilot to hit one of the last free
+        // slots. Keys behind the end are remapped to the slots left free.
+        std::vector<bool> taken(keys.size() + keys.size() / extra_slots(),
+                                false);
+        std::vector<size_type> placed;
+        for (const auto& bucket : buckets) {
+            auto first = keys.begin() + bucket.second;
+            auto last = first + bucket.first;
+            std::uint64_t pilot = 0;
+
+            while (true) {
+                placed.clear();
+                for (auto key = first; key != last; ++key) {
+                    auto index = slot_index(key->first, pilot, taken.size());
+                    if (taken[index]) {
+                        break;
+                    }
+
+                    taken[index] = true;
+                    placed.push_back(index);
+                }
+
+                if (placed.size() == bucket.first) {
+                    break;
+                }
+
+                for (auto index : placed) {
+                    taken[index] = false;
+                }
+
+                if (++pilot > std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::runtime_error("No perfect hash found");
+                }
+            }
+
+            _pilots[bucket_index(first->first)] = std::uint32_t(pilot);
+        }
+
+        _remap.resize(taken.size() - keys.size());
+        size_type free_slot = 0;
+        for (auto index = keys.size(); index != taken.size(); ++index) {
+            if (taken[index]) {
+                while (taken[free_slot]) {
+                    ++free_slot;
+                }
+
+                _remap[index - keys.size()] = std::uint32_t(free_slot++);
+            }
+        }
+
+        std::vector<const value_type*> slots(keys.size());
+        for (const auto& key : keys) {
+            auto index = slot_index(key.first, _pilots[bucket_index(key.first)],
+                                    taken.size());
+            if (index >= slots.size()) {
+                index = _remap[index - slots.size()];
+            }
+
+            slots[index] = key.second;
+        }
+
+        _entries.reserve(slots.size());
+        for (auto element : slots) {
+            _entries.push_back(*element);
+        }
+    }
+
+    entry_vector _entries;
+    pilot_vector _pilots;
+    // slots behind the end of _entries to the free slots they stand for
+    pilot_vector _remap;
+    hasher _hasher;
+    key_equal _key_equal;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef DICT_HUGE_PAGE_ALLOCATOR_HPP
+#define DICT_HUGE_PAGE_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include <sys/mman.h>
+
+namespace io {
+
+namespace detail {
+
+// the transparent huge page size of x86-64 and of most aarch64 kernels
+constexpr std::size_t huge_page_bytes() { return std::size_t(2) << 20; }
+
+constexpr std::size_t round_to_huge_pages(std::size_t bytes) {
+    return (bytes + huge_page_bytes() - 1) & ~(huge_page_bytes() - 1);
+}
+
+// Maps one huge page more than asked for and unmaps what lies before the
+// first huge page boundary and after the end, the kernel only backs aligned
+// ranges with huge pages. Without transparent huge pages, or with them
+// turned off, madvise fails and the range simply stays on small pages.
+inline void* map_huge_pages(std::size_t bytes) {
+    auto data = ::mmap(nullptr, bytes + huge_page_bytes(),
+                       PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (data == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    auto begin = reinterpret_cast<std::uintptr_t>(data);
+    auto aligned = round_to_huge_pages(begin);
+    auto head = aligned - begin;
+    if (head) {
+        ::munmap(data, head);
+    }
+    ::munmap(reinterpret_cast<void*>(aligned + bytes),
+             huge_page_bytes() - head);
+
+#ifdef MADV_HUGEPAGE
+    ::madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);
+#endif
+
+    return reinterpret_cast<void*>(aligned);
+}
+
+inline void unmap_huge_pages(void* data, std::size_t bytes) noexcept {
+    ::munmap(data, bytes);
+}
+
+} // namespace detail
+
+// Maps arrays of at least one huge page with mmap, aligned to and rounded up
+// to huge pages, and asks the kernel to back them with transparent huge
+// pages. A table of many megabytes then needs one TLB entry per 2 MiB
+// instead of per 4 KiB, which is what random lookups into it miss on.
+// Smaller arrays would waste most of a huge page and come from operator new.
+// Mapped arrays are unmapped again on deallocate, all allocators are equal.
+template <typename T>
+class huge_page_allocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "over-aligned types aren't supported");
+
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using is_always_equal = std::true_type;
+
+    huge_page_allocator() noexcept = default;
+
+    template <typename U>
+    huge_page_allocator(const huge_page_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        // leaves room for rounding up and the extra page to align with
+        if (n > (std::numeric_limits<std::size_t>::max() -
+                 2 * detail::huge_page_bytes()) /
+                    sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        auto bytes = n * sizeof(T);
+        if (bytes < min_bytes()) {
+            return static_cast<T*>(::operator new(bytes));
+        }
+
+        return static_cast<T*>(
+            detail::map_huge_pages(detail::round_to_huge_pages(bytes)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        auto bytes = n * sizeof(T);
+        if (bytes < min_bytes()) {
+            ::operator delete(p);
+        } else {
+            detail::unmap_huge_pages(p, detail::round_to_huge_pages(bytes));
+        }
+    }
+
+    // arrays from this size on are mapped
+    static constexpr std::size_t min_bytes() {
+        return detail::huge_page_bytes();
+    }
+
+    template <typename U>
+    bool operator==(const huge_page_allocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const huge_page_allocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,392 @@
+#ifndef DICT_MAPPED_DICT_HPP
+#define DICT_MAPPED_DICT_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dict.hpp"
+
+namespace io {
+
+namespace detail {
+
+constexpr std::size_t dict_file_max_arrays = 4;
+
+// A dict file starts with this header, the arrays of the table follow at the
+// offsets it records. Everything is stored in native byte order and layout,
+// files are only meant to be read on the machine type which wrote them.
+struct dict_file_header {
+    static constexpr std::uint32_t current_version() { return 1; }
+    static constexpr std::uint32_t native_byte_order() { return 0x01020304; }
+    // keeps the arrays aligned for any entry and on their own cache lines
+    static constexpr std::size_t alignment() { return 64; }
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t layout;
+    std::uint32_t array_count;
+    std::uint64_t key_size;
+    std::uint64_t value_size;
+    std::uint64_t entry_size;
+    std::uint64_t table_size;
+    std::uint64_t element_count;
+    std::uint64_t array_offset[dict_file_max_arrays];
+    std::uint64_t array_bytes[dict_file_max_arrays];
+};
+
+constexpr char dict_file_magic[8] = { 'i', 'o', ':', ':', 'd', 'i', 'c', 't' };
+
+inline std::uint64_t align_file_offset(std::uint64_t offset) {
+    auto alignment = dict_file_header::alignment();
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Hands out zero filled memory, so that a table built in it has nothing but
+// zeros wherever it doesn't write, e.g. in free slots and padding.
+template <typename T>
+struct zeroed_allocator {
+    using value_type = T;
+
+    zeroed_allocator() noexcept = default;
+
+    template <typename U>
+    zeroed_allocator(const zeroed_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        auto data = std::allocator<T>().allocate(n);
+        std::memset(static_cast<void*>(data), 0, n * sizeof(T));
+        return data;
+    }
+
+    void deallocate(T* data, std::size_t n) noexcept {
+        std::allocator<T>().deallocate(data, n);
+    }
+
+    template <typename U>
+    bool operator==(const zeroed_allocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const zeroed_allocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+template <typename Table, typename Key, typename Value>
+dict_file_header make_dict_file_header(std::uint64_t table_size,
+                                       std::uint64_t element_count) {
+    dict_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, dict_file_magic, sizeof(header.magic));
+    header.version = dict_file_header::current_version();
+    header.byte_order = dict_file_header::native_byte_order();
+    header.layout = Table::layout();
+    header.key_size = sizeof(Key);
+    header.value_size = sizeof(Value);
+    header.entry_size = sizeof(typename Table::entry_type);
+    header.table_size = table_size;
+    header.element_count = element_count;
+    return header;
+}
+
+struct dict_file {
+    // Free slots of a table are raw memory which may still hold erased
+    // entries, so the file is written from a copy of the table in zeroed
+    // memory which only has the used slots, at the same indices.
+    template <typename Storage, typename Dict>
+    static void write(const Dict& d, const std::string& path) {
+        if (d.rehashing()) {
+            throw std::logic_error("Finish rehashing before writing a dict");
+        }
+
+        using table_type = typename Storage::template table<
+            typename Dict::entry_type,
+            zeroed_allocator<typename Dict::value_type>>;
+        table_type table{ zeroed_allocator<typename Dict::value_type>() };
+        table.resize(d._table.size());
+        for (auto index = d._table.next_used(0); index != d._table.size();
+             index = d._table.next_used(index + 1)) {
+            table.construct(index, d._table[index].hash(d._hasher),
+                            d._table[index]);
+        }
+
+        auto header =
+            make_dict_file_header<table_type, typename Dict::key_type,
+                                  typename Dict::mapped_type>(table.size(),
+                                                              d.size());
+
+        std::vector<std::pair<const void*, std::size_t>> arrays;
+        table.for_each_array([&](const void* data, std::size_t bytes) {
+            arrays.emplace_back(data, bytes);
+        });
+
+        auto offset = align_file_offset(sizeof(header));
+        header.array_count = arrays.size();
+        for (std::size_t i = 0; i != arrays.size(); ++i) {
+            header.array_offset[i] = offset;
+            header.array_bytes[i] = arrays[i].second;
+            offset = align_file_offset(offset + arrays[i].second);
+        }
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Can't open " + path);
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (std::size_t i = 0; i != arrays.size(); ++i) {
+            while (std::uint64_t(out.tellp()) < header.array_offset[i]) {
+                out.put(0);
+            }
+
+            out.write(static_cast<const char*>(arrays[i].first),
+                      arrays[i].second);
+        }
+
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Can't write " + path);
+        }
+    }
+};
+
+// a whole file mapped read only
+class file_mapping {
+public:
+    explicit file_mapping(const std::string& path) : _data(), _size() {
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Can't open " + path);
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(),
+                                    "Can't stat " + path);
+        }
+
+        _size = info.st_size;
+        if (_size) {
+            _data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        auto error = errno;
+        ::close(fd);
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            throw std::system_error(error, std::generic_category(),
+                                    "Can't map " + path);
+        }
+    }
+
+    file_mapping(const file_mapping&) = delete;
+    file_mapping& operator=(const file_mapping&) = delete;
+
+    ~file_mapping() {
+        if (_data) {
+            ::munmap(_data, _size);
+        }
+    }
+
+    const char* data() const { return static_cast<const char*>(_data); }
+
+    std::size_t size() const { return _size; }
+
+private:
+    void* _data;
+    std::size_t _size;
+};
+
+} // namespace detail
+
+// Writes the table of d to path so mapped_dict can open it without copying
+// or rehashing anything. Throws std::logic_error while d rehashes
+// incrementally.
+template <typename Key, typename Value, typename Hasher, typename KeyEqual,
+          typename Allocator, typename Storage>
+void write_mapped_dict(
+    const dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>& d,
+    const std::string& path) {
+    static_assert(std::is_trivially_copyable<Key>::value &&
+                      std::is_trivially_copyable<Value>::value,
+                  "Only dicts of trivially copyable types can be mapped");
+    detail::dict_file::write<Storage>(d, path);
+}
+
+// A read only dict on top of a file written by write_mapped_dict. The file is
+// mapped and lookups probe the mapped table directly, so opening takes the
+// same time for any size and pages are only read once they are touched.
+//
+// Hasher, KeyEqual and Storage have to match those of the written dict. The
+// header is checked against the types and a few of the stored keys are looked
+// up to catch a different hasher.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Storage = inline_flag_storage>
+class mapped_dict {
+    static_assert(std::is_trivially_copyable<Key>::value &&
+                      std::is_trivially_copyable<Value>::value,
+                  "Only dicts of trivially copyable types can be mapped");
+
+    using entry_type =
+        detail::dict_entry<Key, Value, cache_hash<Key, Hasher>::value>;
+    using table_type = typename Storage::template table<
+        entry_type, std::allocator<std::pair<const Key, Value>>>;
+    using view_type = typename table_type::view;
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    using value_type = std::pair<const Key, Value>;
+    using size_type = typename view_type::size_type;
+
+    // elements can't be changed, both iterators are const
+    using iterator = detail::const_dict_iterator<view_type>;
+    using const_iterator = detail::const_dict_iterator<view_type>;
+
+    explicit mapped_dict(const std::string& path,
+                         const Hasher& hash = Hasher(),
+                         const KeyEqual& key_equal = KeyEqual())
+        : _file(path), _view(open_view(_file)),
+          _element_count(header(_file).element_count), _hasher(hash),
+          _key_equal(key_equal) {
+        check_hasher();
+    }
+
+    mapped_dict(const mapped_dict&) = delete;
+    mapped_dict& operator=(const mapped_dict&) = delete;
+
+    const_iterator begin() const { return { _view, view_type(), 0 }; }
+
+    const_iterator end() const { return { _view, _view.size(), true }; }
+
+    const_iterator cbegin() const { return begin(); }
+
+    const_iterator cend() const { return end(); }
+
+    bool empty() const noexcept { return _element_count == 0; }
+
+    size_type size() const noexcept { return _element_count; }
+
+    const_iterator find(const Key& key) const {
+        auto index = _view.find(key, _hasher(key), _key_equal);
+        if (!index.second) {
+            return end();
+        }
+
+        return { _view, index.first, true };
+    }
+
+    size_type count(const Key& key) const { return find(key) == end() ? 0 : 1; }
+
+    const Value& at(const Key& key) const {
+        auto iter = find(key);
+        if (iter == end()) {
+            throw std::out_of_range("Key not in dict");
+        }
+
+        return iter->second;
+    }
+
+    void prefetch(const Key& key) const { _view.prefetch(_hasher(key)); }
+
+    hasher hash_function() const { return _hasher; }
+
+    key_equal key_eq() const { return _key_equal; }
+
+private:
+    using header_type = detail::dict_file_header;
+
+    static const header_type& header(const detail::file_mapping& file) {
+        return *reinterpret_cast<const header_type*>(file.data());
+    }
+
+    static view_type open_view(const detail::file_mapping& file) {
+        if (file.size() < sizeof(header_type) ||
+            std::memcmp(header(file).magic, detail::dict_file_magic,
+                        sizeof(detail::dict_file_magic)) != 0) {
+            throw std::runtime_error("Not a dict file");
+        }
+
+        const auto& h = header(file);
+        if (h.version != header_type::current_version() ||
+            h.byte_order != header_type::native_byte_order()) {
+            throw std::runtime_error("Unsupported dict file version");
+        }
+
+        auto expected = detail::make_dict_file_header<table_type, Key, Value>(
+            h.table_size, h.element_count);
+        std::size_t array_count = 0;
+        table_type(std::allocator<std::pair<const Key, Value>>())
+            .for_each_array([&](const void*, std::size_t) { ++array_count; });
+
+        if (h.layout != expected.layout || h.key_size != expected.key_size ||
+            h.value_size != expected.value_size ||
+            h.entry_size != expected.entry_size ||
+            h.array_count != array_count || !h.table_size ||
+            (h.table_size & (h.table_size - 1)) ||
+            h.element_count >= h.table_size) {
+            throw std::runtime_error("Dict file doesn't match the dict type");
+        }
+
+        const void* arrays[detail::dict_file_max_arrays];
+        std::size_t bytes[detail::dict_file_max_arrays];
+        for (std::size_t i = 0; i != array_count; ++i) {
+            if (h.array_offset[i] % header_type::alignment() ||
+                h.array_offset[i] > file.size() ||
+                h.array_bytes[i] > file.size() - h.array_offset[i]) {
+                throw std::runtime_error("Dict file is truncated");
+            }
+
+            arrays[i] = file.data() + h.array_offset[i];
+            bytes[i] = h.array_bytes[i];
+        }
+
+        return view_type(arrays, bytes, h.table_size);
+    }
+
+    // a hasher which differs from the writer's sends lookups to the wrong
+    // slots, this finds out on the first few elements
+    void check_hasher() const {
+        std::size_t checked = 0;
+        for (auto iter = begin(); iter != end() && checked != 16;
+             ++iter, ++checked) {
+            if (find(iter->first) != iter) {
+                throw std::runtime_error(
+                    "Hasher doesn't match the one the dict was written with");
+            }
+        }
+    }
+
+    detail::file_mapping _file;
+    view_type _view;
+    size_type _element_count;
+    hasher _hasher;
+    key_equal _key_equal;
+};
+
+} // namespace io
+
+#endif
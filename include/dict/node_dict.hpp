@@ -0,0 +1,23 @@
+#ifndef DICT_NODE_DICT_HPP
+#define DICT_NODE_DICT_HPP
+
+#include <functional>
+#include <utility>
+
+#include "dict.hpp"
+#include "pool_allocator.hpp"
+
+namespace io {
+
+// A dict whose slots point to its elements instead of holding them. Rehashing
+// and erasing move pointers, so references and pointers to elements stay
+// valid until the element itself is erased, which also makes growing cheap
+// for large values. The elements come from slabs of a pool_allocator.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = pool_allocator<std::pair<const Key, Value>>>
+using node_dict = dict<Key, Value, Hasher, KeyEqual, Allocator, node_storage>;
+
+} // namespace io
+
+#endif
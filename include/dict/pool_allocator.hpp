@@ -0,0 +1,198 @@
+#ifndef DICT_POOL_ALLOCATOR_HPP
+#define DICT_POOL_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace io {
+
+namespace detail {
+
+// Hands out blocks of one size carved from slabs which double in size up to
+// max_slab_bytes(). Freed blocks go onto an intrusive free list and are handed
+// out again before the current slab is used further. Slabs are only given
+// back when the pool is destroyed.
+class slab_pool {
+public:
+    explicit slab_pool(std::size_t block_size)
+        : _block_size(block_size), _slab_blocks(min_slab_blocks()),
+          _free(nullptr), _next(nullptr), _end(nullptr) {}
+
+    slab_pool(slab_pool&& other) noexcept
+        : _block_size(other._block_size), _slab_blocks(other._slab_blocks),
+          _free(other._free), _next(other._next), _end(other._end),
+          _slabs(std::move(other._slabs)) {
+        other._free = nullptr;
+        other._next = other._end = nullptr;
+        other._slabs.clear();
+    }
+
+    slab_pool(const slab_pool&) = delete;
+    slab_pool& operator=(const slab_pool&) = delete;
+
+    ~slab_pool() {
+        for (auto slab : _slabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    std::size_t block_size() const noexcept { return _block_size; }
+
+    void* allocate() {
+        if (_free) {
+            auto block = _free;
+            _free = block->next;
+            return block;
+        }
+
+        if (_next == _end) {
+            add_slab();
+        }
+
+        auto block = _next;
+        _next += _block_size;
+        return block;
+    }
+
+    void deallocate(void* block) noexcept {
+        _free = ::new (block) free_block{ _free };
+    }
+
+    static constexpr std::size_t min_slab_blocks() { return 16; }
+    static constexpr std::size_t max_slab_bytes() { return 1 << 20; }
+
+private:
+    struct free_block {
+        free_block* next;
+    };
+
+    void add_slab() {
+        _slabs.reserve(_slabs.size() + 1);
+        auto bytes = _slab_blocks * _block_size;
+        _next = static_cast<char*>(::operator new(bytes));
+        _end = _next + bytes;
+        _slabs.push_back(_next);
+
+        if (bytes * 2 <= max_slab_bytes()) {
+            _slab_blocks *= 2;
+        }
+    }
+
+    std::size_t _block_size;
+    std::size_t _slab_blocks;
+    free_block* _free;
+    char* _next;
+    char* _end;
+    std::vector<void*> _slabs;
+};
+
+// the pools of all allocators rebound from one another, one per block size
+class slab_pools {
+public:
+    slab_pool& get(std::size_t block_size) {
+        for (auto& pool : _pools) {
+            if (pool.block_size() == block_size) {
+                return pool;
+            }
+        }
+
+        _pools.emplace_back(block_size);
+        return _pools.back();
+    }
+
+private:
+    std::vector<slab_pool> _pools;
+};
+
+} // namespace detail
+
+// Allocates single objects from slabs shared by all copies and rebinds of an
+// allocator, larger arrays come from operator new. Meant for the nodes of
+// io::node_dict: a node costs no malloc header, nodes allocated one after
+// another lie next to each other and freeing one is a push onto a list.
+//
+// A default constructed allocator starts a new set of pools. Copying a
+// container gives the copy its own pools, so containers never share pools
+// unless they are given the same allocator. The pools aren't thread safe.
+template <typename T>
+class pool_allocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "over-aligned types aren't supported");
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    pool_allocator() : _pools(std::make_shared<detail::slab_pools>()) {}
+
+    // moving copies too, a moved from allocator still owns its pools
+    pool_allocator(const pool_allocator&) = default;
+    pool_allocator& operator=(const pool_allocator&) = default;
+
+    template <typename U>
+    pool_allocator(const pool_allocator<U>& other) noexcept
+        : _pools(other._pools) {}
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(_pools->get(block_size()).allocate());
+        }
+
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (n == 1) {
+            _pools->get(block_size()).deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    pool_allocator select_on_container_copy_construction() const {
+        return pool_allocator();
+    }
+
+    template <typename U>
+    bool operator==(const pool_allocator<U>& other) const noexcept {
+        return _pools == other._pools;
+    }
+
+    template <typename U>
+    bool operator!=(const pool_allocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    template <typename U>
+    friend class pool_allocator;
+
+    static constexpr std::size_t block_alignment() {
+        return alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    }
+
+    // big enough and aligned enough to hold the free list link as well, a
+    // multiple of the alignment so consecutive blocks stay aligned
+    static constexpr std::size_t block_size() {
+        return ((sizeof(T) > sizeof(void*) ? sizeof(T) : sizeof(void*)) +
+                block_alignment() - 1) /
+               block_alignment() * block_alignment();
+    }
+
+    std::shared_ptr<detail::slab_pools> _pools;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef DICT_READ_MOSTLY_DICT_HPP
+#define DICT_READ_MOSTLY_DICT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dict.hpp"
+#include "detail/cache_aligned_allocator.hpp"
+
+namespace io {
+
+// A map for data which is read far more often than it changes, built with the
+// left-right technique: there are two copies of the dict, readers use the
+// active one while the writer changes the other. After a batch the writer
+// flips the active copy, waits for readers still on the old one to leave and
+// replays the batch there.
+//
+// Readers go through a reader handle which owns a slot on its own cache line
+// that only this reader writes to, so reading never writes shared memory and
+// never waits. Writers are serialised by a mutex and wait for readers.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>,
+          typename Storage = inline_flag_storage>
+class read_mostly_dict {
+public:
+    using dict_type = dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>;
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = typename dict_type::value_type;
+    using size_type = typename dict_type::size_type;
+
+private:
+    // which copy a reader is in, 0 when it isn't reading
+    struct reader_slot {
+        reader_slot() : reading(0), in_use(true), depth(0) {}
+
+        // a slot fills its cache line, slots come from a cache aligned
+        // allocator one by one
+        alignas(detail::cache_line_bytes()) std::atomic<unsigned> reading;
+        std::atomic<bool> in_use;
+        // reads running on the reader's thread, nested ones from inside a
+        // callback stay on the copy of the outermost read
+        unsigned depth;
+    };
+
+    using slot_allocator = detail::cache_aligned_allocator<reader_slot>;
+
+    struct slot_deleter {
+        void operator()(reader_slot* slot) const {
+            slot->~reader_slot();
+            slot_allocator().deallocate(slot, 1);
+        }
+    };
+
+public:
+    // A list of changes applied at once by apply(), they take effect for
+    // readers all together.
+    class batch {
+    public:
+        template <typename Mapped>
+        void insert_or_assign(const Key& key, Mapped&& mapped) {
+            _values.emplace_back(std::forward<Mapped>(mapped));
+            _ops.push_back(op{ key, _values.size() - 1 });
+        }
+
+        void erase(const Key& key) { _ops.push_back(op{ key, erase_op() }); }
+
+        bool empty() const { return _ops.empty(); }
+
+        void clear() {
+            _ops.clear();
+            _values.clear();
+        }
+
+    private:
+        friend class read_mostly_dict;
+
+        // the index of the value to assign, erases have none so Value needn't
+        // be default constructible
+        struct op {
+            Key key;
+            std::size_t value;
+        };
+
+        static constexpr std::size_t erase_op() { return std::size_t(-1); }
+
+        void apply_to(dict_type& d) const {
+            for (const auto& op : _ops) {
+                if (op.value == erase_op()) {
+                    d.erase(op.key);
+                } else {
+                    d.insert_or_assign(op.key, _values[op.value]);
+                }
+            }
+        }
+
+        std::vector<op> _ops;
+        std::vector<Value> _values;
+    };
+
+    // A reader's access to the dict, create one per reading thread and keep
+    // it around. Must not outlive the read_mostly_dict.
+    class reader {
+    public:
+        reader(reader&& other) : _owner(other._owner), _slot(other._slot) {
+            other._slot = nullptr;
+        }
+
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+        reader& operator=(reader&&) = delete;
+
+        ~reader() {
+            if (_slot) {
+                _slot->in_use.store(false, std::memory_order_release);
+            }
+        }
+
+        // calls fn with the current dict, which doesn't change while fn runs
+        template <typename Fn>
+        auto read(Fn fn) const
+            -> decltype(fn(std::declval<const dict_type&>())) {
+            read_guard guard(*this);
+            return fn(_owner->_copies[guard.copy]);
+        }
+
+        // copies the mapped value of key into value if it's in the dict
+        bool find(const Key& key, Value& value) const {
+            return visit(key, [&](const value_type& element) {
+                value = element.second;
+            });
+        }
+
+        bool contains(const Key& key) const {
+            return read([&](const dict_type& d) {
+                return d.find(key) != d.end();
+            });
+        }
+
+        // calls fn with the element of key, returns whether it was found
+        template <typename Fn>
+        bool visit(const Key& key, Fn fn) const {
+            return read([&](const dict_type& d) {
+                auto iter = d.find(key);
+                if (iter == d.end()) {
+                    return false;
+                }
+
+                fn(*iter);
+                return true;
+            });
+        }
+
+    private:
+        friend class read_mostly_dict;
+
+        reader(const read_mostly_dict* owner, reader_slot* slot)
+            : _owner(owner), _slot(slot) {}
+
+        // announces the copy in use and makes sure the writer saw that
+        // before it could have started changing it, a nested guard keeps
+        // the copy the outermost one announced
+        struct read_guard {
+            explicit read_guard(const reader& r) : slot(*r._slot) {
+                if (slot.depth++ != 0) {
+                    copy = slot.reading.load(std::memory_order_relaxed) - 1;
+                    return;
+                }
+
+                copy = r._owner->_active.load(std::memory_order_seq_cst);
+                while (true) {
+                    slot.reading.store(copy + 1, std::memory_order_seq_cst);
+                    auto active =
+                        r._owner->_active.load(std::memory_order_seq_cst);
+                    if (active == copy) {
+                        break;
+                    }
+
+                    copy = active;
+                }
+            }
+
+            read_guard(const read_guard&) = delete;
+            read_guard& operator=(const read_guard&) = delete;
+
+            ~read_guard() {
+                if (--slot.depth == 0) {
+                    slot.reading.store(0, std::memory_order_release);
+                }
+            }
+
+            reader_slot& slot;
+            unsigned copy;
+        };
+
+        const read_mostly_dict* _owner;
+        reader_slot* _slot;
+    };
+
+    read_mostly_dict() : read_mostly_dict(dict_type()) {}
+
+    explicit read_mostly_dict(const dict_type& initial)
+        : _copies{ initial, initial }, _active(0) {}
+
+    read_mostly_dict(const read_mostly_dict&) = delete;
+    read_mostly_dict& operator=(const read_mostly_dict&) = delete;
+
+    reader make_reader() {
+        std::lock_guard<std::mutex> lock(_writer_mutex);
+
+        for (auto& slot : _slots) {
+            if (!slot->in_use.load(std::memory_order_acquire)) {
+                slot->in_use.store(true, std::memory_order_relaxed);
+                return reader(this, slot.get());
+            }
+        }
+
+        // readers keep pointers to their slots, which therefore never move
+        _slots.reserve(_slots.size() + 1);
+        _slots.emplace_back(::new (slot_allocator().allocate(1)) reader_slot());
+        return reader(this, _slots.back().get());
+    }
+
+    // applies all changes in changes and returns once no reader can see the
+    // previous state anymore
+    void apply(const batch& changes) {
+        std::lock_guard<std::mutex> lock(_writer_mutex);
+
+        auto old_copy = _active.load(std::memory_order_relaxed);
+        auto new_copy = 1 - old_copy;
+
+        changes.apply_to(_copies[new_copy]);
+        _active.store(new_copy, std::memory_order_seq_cst);
+
+        for (const auto& slot : _slots) {
+            while (slot->reading.load(std::memory_order_seq_cst) ==
+                   old_copy + 1) {
+                std::this_thread::yield();
+            }
+        }
+
+        changes.apply_to(_copies[old_copy]);
+    }
+
+    template <typename Mapped>
+    void insert_or_assign(const Key& key, Mapped&& mapped) {
+        batch changes;
+        changes.insert_or_assign(key, std::forward<Mapped>(mapped));
+        apply(changes);
+    }
+
+    void erase(const Key& key) {
+        batch changes;
+        changes.erase(key);
+        apply(changes);
+    }
+
+private:
+    dict_type _copies[2];
+    std::atomic<unsigned> _active;
+    std::mutex _writer_mutex;
+    std::vector<std::unique_ptr<reader_slot, slot_deleter>> _slots;
+};
+
+} // namespace io
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef DICT_RECYCLING_RESOURCE_HPP
+#define DICT_RECYCLING_RESOURCE_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#if defined(__has_include)
+#if __cplusplus >= 201703L && __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#endif
+
+#if __cpp_lib_memory_resource
+
+namespace io {
+
+namespace pmr {
+
+// Keeps the blocks given back to it on a free list per block size and hands
+// them out again for the next request of that size, everything else comes
+// from upstream. Meant to sit on a std::pmr::monotonic_buffer_resource: a
+// dict which grows deallocates the table it outgrew, which a monotonic
+// arena simply drops, while this resource reuses it for the next table of
+// that size, e.g. the one of the next dict built in the same arena.
+//
+// The tables of a dict are powers of two, so only a handful of sizes ever
+// show up and a free list is found by a short scan. Free blocks are given
+// back to upstream on release() and destruction, blocks in use have to be
+// deallocated before. Not thread safe, like the std unsynchronized pool.
+class recycling_resource : public std::pmr::memory_resource {
+public:
+    recycling_resource() : recycling_resource(std::pmr::get_default_resource()) {}
+
+    explicit recycling_resource(std::pmr::memory_resource* upstream)
+        : _upstream(upstream) {}
+
+    recycling_resource(const recycling_resource&) = delete;
+    recycling_resource& operator=(const recycling_resource&) = delete;
+
+    ~recycling_resource() override { release(); }
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+        return _upstream;
+    }
+
+    // gives the free blocks back to upstream
+    void release() noexcept {
+        for (auto& list : _lists) {
+            while (list.free) {
+                auto block = list.free;
+                list.free = block->next;
+                _upstream->deallocate(block, list.bytes, list.alignment);
+            }
+        }
+    }
+
+protected:
+    // the list is made here so that deallocating never allocates
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto& list = get(block_bytes(bytes), block_alignment(alignment));
+        if (list.free) {
+            auto block = list.free;
+            list.free = block->next;
+            return block;
+        }
+
+        return _upstream->allocate(list.bytes, list.alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes,
+                       std::size_t alignment) override {
+        auto& list = get(block_bytes(bytes), block_alignment(alignment));
+        list.free = ::new (p) free_block{ list.free };
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+        noexcept override {
+        return this == &other;
+    }
+
+private:
+    struct free_block {
+        free_block* next;
+    };
+
+    struct free_list {
+        std::size_t bytes;
+        std::size_t alignment;
+        free_block* free;
+    };
+
+    // big enough and aligned enough to link a free block
+    static std::size_t block_bytes(std::size_t bytes) {
+        return bytes < sizeof(free_block) ? sizeof(free_block) : bytes;
+    }
+
+    static std::size_t block_alignment(std::size_t alignment) {
+        return alignment < alignof(free_block) ? alignof(free_block)
+                                               : alignment;
+    }
+
+    free_list& get(std::size_t bytes, std::size_t alignment) {
+        for (auto& list : _lists) {
+            if (list.bytes == bytes && list.alignment == alignment) {
+                return list;
+            }
+        }
+
+        _lists.push_back(free_list{ bytes, alignment, nullptr });
+        return _lists.back();
+    }
+
+    std::pmr::memory_resource* _upstream;
+    std::vector<free_list> _lists;
+};
+
+} // namespace pmr
+
+} // namespace io
+
+#endif
+
+#endif
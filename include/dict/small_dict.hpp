@@ -0,0 +1,574 @@
+#ifndef DICT_SMALL_DICT_HPP
+#define DICT_SMALL_DICT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "dict.hpp"
+#include "detail/entry.hpp"
+#include "detail/key_value.hpp"
+
+namespace io {
+
+template <typename Key, typename Value, std::size_t N, typename Hasher,
+          typename KeyEqual, typename Allocator, typename Storage>
+class small_dict;
+
+namespace detail {
+
+// walks the inline slots of a small_dict or, once it spilled, its dict
+template <typename Value, typename Slot, typename DictIterator>
+class small_dict_iterator
+    : public boost::iterator_facade<
+          small_dict_iterator<Value, Slot, DictIterator>, Value,
+          boost::forward_traversal_tag> {
+public:
+    small_dict_iterator() : _slot(), _spilled() {}
+    explicit small_dict_iterator(Slot* slot) : _slot(slot), _spilled() {}
+    explicit small_dict_iterator(DictIterator spilled)
+        : _slot(), _spilled(spilled) {}
+
+    template <typename OtherValue, typename OtherSlot, typename OtherIterator>
+    small_dict_iterator(
+        const small_dict_iterator<OtherValue, OtherSlot, OtherIterator>& other)
+        : _slot(other._slot), _spilled(other._spilled) {}
+
+private:
+    friend class boost::iterator_core_access;
+    template <typename, typename, typename>
+    friend class small_dict_iterator;
+    // erase needs the slot or dict iterator of its position
+    template <typename, typename, std::size_t, typename, typename, typename,
+              typename>
+    friend class io::small_dict;
+
+    void increment() {
+        if (_slot) {
+            ++_slot;
+        } else {
+            ++_spilled;
+        }
+    }
+
+    template <typename OtherValue, typename OtherSlot, typename OtherIterator>
+    bool equal(const small_dict_iterator<OtherValue, OtherSlot,
+                                         OtherIterator>& other) const {
+        return _slot == other._slot && _spilled == other._spilled;
+    }
+
+    Value& dereference() const {
+        return _slot ? _slot->get().const_view : *_spilled;
+    }
+
+    Slot* _slot;
+    DictIterator _spilled;
+};
+
+} // namespace detail
+
+// A map for a handful of elements. Up to N elements are kept inline in the
+// object and looked up by comparing keys one after another, which for a few
+// keys is cheaper than hashing, so a small_dict which never grows beyond N
+// never allocates. Inserting one more element spills all of them into a dict
+// behind a pointer which is used from then on, until clear().
+template <typename Key, typename Value, std::size_t N = 8,
+          typename Hasher = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, Value>>,
+          typename Storage = inline_flag_storage>
+class small_dict {
+    static_assert(N != 0, "a small_dict needs room for one inline element");
+
+public:
+    using dict_type = dict<Key, Value, Hasher, KeyEqual, Allocator, Storage>;
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using allocator_type = Allocator;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    using value_type = typename dict_type::value_type;
+    using size_type = typename dict_type::size_type;
+    using difference_type = typename dict_type::difference_type;
+    using reference = value_type&;
+
+private:
+    using slot = detail::raw_entry<detail::key_value<Key, Value>>;
+
+public:
+    using iterator = detail::small_dict_iterator<value_type, slot,
+                                                 typename dict_type::iterator>;
+    using const_iterator =
+        detail::small_dict_iterator<const value_type, const slot,
+                                    typename dict_type::const_iterator>;
+
+    small_dict() : small_dict(Hasher()) {}
+
+    explicit small_dict(const Hasher& hash,
+                        const KeyEqual& key_equal = KeyEqual(),
+                        const Allocator& alloc = Allocator())
+        : _size(0), _hasher(hash), _key_equal(key_equal), _alloc(alloc) {}
+
+    explicit small_dict(const Allocator& alloc)
+        : small_dict(Hasher(), KeyEqual(), alloc) {}
+
+    template <typename Iter>
+    small_dict(Iter begin, Iter end, const Hasher& hash = Hasher(),
+               const KeyEqual& key_equal = KeyEqual(),
+               const Allocator& alloc = Allocator())
+        : small_dict(hash, key_equal, alloc) {
+        insert(begin, end);
+    }
+
+    small_dict(std::initializer_list<value_type> init,
+               const Hasher& hash = Hasher(),
+               const KeyEqual& key_equal = KeyEqual(),
+               const Allocator& alloc = Allocator())
+        : small_dict(init.begin(), init.end(), hash, key_equal, alloc) {}
+
+    // delegates so that the destructor cleans up if copying an element throws
+    small_dict(const small_dict& other)
+        : small_dict(other._hasher, other._key_equal,
+                     std::allocator_traits<Allocator>::
+                         select_on_container_copy_construction(other._alloc)) {
+        if (other._spilled) {
+            _spilled.reset(new dict_type(*other._spilled));
+            return;
+        }
+
+        for (; _size != other._size; ++_size) {
+            _slots[_size].construct(other._slots[_size].get());
+        }
+    }
+
+    small_dict(small_dict&& other) noexcept(
+        std::is_nothrow_move_constructible<detail::key_value<Key, Value>>::value)
+        : small_dict(other._hasher, other._key_equal, other._alloc) {
+        take_elements(other);
+    }
+
+    small_dict& operator=(const small_dict& other) {
+        if (this != &other) {
+            *this = small_dict(other);
+        }
+        return *this;
+    }
+
+    small_dict& operator=(small_dict&& other) noexcept(
+        std::is_nothrow_move_constructible<detail::key_value<Key, Value>>::value) {
+        if (this != &other) {
+            clear();
+            _hasher = other._hasher;
+            _key_equal = other._key_equal;
+            _alloc = other._alloc;
+            take_elements(other);
+        }
+        return *this;
+    }
+
+    small_dict& operator=(std::initializer_list<value_type> init) {
+        clear();
+        insert(init);
+        return *this;
+    }
+
+    ~small_dict() { destroy_slots(); }
+
+    allocator_type get_allocator() const { return _alloc; }
+
+    hasher hash_function() const { return _hasher; }
+
+    key_equal key_eq() const { return _key_equal; }
+
+    iterator begin() noexcept {
+        return _spilled ? iterator(_spilled->begin()) : iterator(_slots);
+    }
+
+    const_iterator begin() const noexcept {
+        return _spilled ? const_iterator(_spilled->cbegin())
+                        : const_iterator(_slots);
+    }
+
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator end() noexcept {
+        return _spilled ? iterator(_spilled->end()) : iterator(_slots + _size);
+    }
+
+    const_iterator end() const noexcept {
+        return _spilled ? const_iterator(_spilled->cend())
+                        : const_iterator(_slots + _size);
+    }
+
+    const_iterator cend() const noexcept { return end(); }
+
+    size_type size() const noexcept {
+        return _spilled ? _spilled->size() : _size;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+
+    // whether the elements moved out into a dict
+    bool spilled() const noexcept { return _spilled != nullptr; }
+
+    static constexpr size_type inline_capacity() { return N; }
+
+    // goes back to inline storage, a spilled dict is freed
+    void clear() {
+        destroy_slots();
+        _size = 0;
+        _spilled.reset();
+    }
+
+    // spills right away if n elements don't fit inline
+    void reserve(size_type n) {
+        if (!_spilled && n > N) {
+            spill(n);
+        }
+
+        if (_spilled) {
+            _spilled->reserve(n);
+        }
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if (_spilled) {
+            return wrap(_spilled->emplace(std::forward<Args>(args)...));
+        }
+
+        detail::key_value<Key, Value> element(std::forward<Args>(args)...);
+        auto index = find_slot(element.view.first);
+        if (index != _size) {
+            return { iterator(_slots + index), false };
+        }
+
+        if (_size == N) {
+            spill(N + 1);
+            return wrap(_spilled->try_emplace(std::move(element.view.first),
+                                              std::move(element.view.second)));
+        }
+
+        _slots[_size].construct(std::move(element));
+        return { iterator(_slots + _size++), true };
+    }
+
+    template <typename... Args>
+    iterator emplace_hint(const_iterator /* hint */, Args&&... args) {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+        return try_emplace_impl(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return emplace(value);
+    }
+
+    template <typename P,
+              typename = typename std::enable_if<
+                  std::is_constructible<value_type, P&&>::value>::type>
+    std::pair<iterator, bool> insert(P&& value) {
+        return emplace(std::forward<P>(value));
+    }
+
+    template <typename InputIt>
+    void insert(InputIt begin, InputIt end) {
+        for (auto iter = begin; iter != end; ++iter) {
+            emplace(*iter);
+        }
+    }
+
+    void insert(std::initializer_list<value_type> init) {
+        insert(init.begin(), init.end());
+    }
+
+    template <typename Mapped>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key,
+                                               Mapped&& mapped) {
+        return insert_or_assign_impl(key, std::forward<Mapped>(mapped));
+    }
+
+    template <typename Mapped>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key,
+                                               Mapped&& mapped) {
+        return insert_or_assign_impl(std::move(key),
+                                     std::forward<Mapped>(mapped));
+    }
+
+    Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    Value& operator[](Key&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    iterator find(const Key& key) {
+        if (_spilled) {
+            return iterator(_spilled->find(key));
+        }
+
+        return iterator(_slots + find_slot(key));
+    }
+
+    const_iterator find(const Key& key) const {
+        if (_spilled) {
+            return const_iterator(
+                static_cast<const dict_type&>(*_spilled).find(key));
+        }
+
+        return const_iterator(_slots + find_slot(key));
+    }
+
+    size_type count(const Key& key) const { return find(key) == end() ? 0 : 1; }
+
+    Value& at(const Key& key) {
+        auto iter = find(key);
+        if (iter == end()) {
+            throw std::out_of_range("Key not in dict");
+        }
+
+        return iter->second;
+    }
+
+    const Value& at(const Key& key) const {
+        auto iter = find(key);
+        if (iter == end()) {
+            throw std::out_of_range("Key not in dict");
+        }
+
+        return iter->second;
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& key) {
+        auto iter = find(key);
+        return { iter, iter == end() ? iter : std::next(iter) };
+    }
+
+    std::pair<const_iterator, const_iterator>
+    equal_range(const Key& key) const {
+        auto iter = find(key);
+        return { iter, iter == end() ? iter : std::next(iter) };
+    }
+
+    size_type erase(const key_type& key) {
+        if (_spilled) {
+            return _spilled->erase(key);
+        }
+
+        auto index = find_slot(key);
+        if (index == _size) {
+            return 0;
+        }
+
+        erase_slot(index);
+        return 1;
+    }
+
+    // the last inline element takes the place of the erased one, so the
+    // returned iterator points at it
+    iterator erase(const_iterator pos) {
+        if (_spilled) {
+            return iterator(_spilled->erase(pos._spilled));
+        }
+
+        auto index = static_cast<size_type>(pos._slot - _slots);
+        erase_slot(index);
+        return iterator(_slots + index);
+    }
+
+    template <typename Predicate>
+    size_type erase_if(Predicate pred) {
+        if (_spilled) {
+            return _spilled->erase_if(pred);
+        }
+
+        const auto old_size = _size;
+        for (size_type index = 0; index != _size;) {
+            if (pred(static_cast<const value_type&>(
+                    _slots[index].get().const_view))) {
+                erase_slot(index);
+            } else {
+                ++index;
+            }
+        }
+
+        return old_size - _size;
+    }
+
+    void swap(small_dict& other) {
+        small_dict moved(std::move(other));
+        other = std::move(*this);
+        *this = std::move(moved);
+    }
+
+private:
+    size_type find_slot(const Key& key) const {
+        size_type index = 0;
+        while (index != _size &&
+               !_key_equal(_slots[index].get().view.first, key)) {
+            ++index;
+        }
+
+        return index;
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args) {
+        if (_spilled) {
+            return wrap(_spilled->try_emplace(std::forward<K>(key),
+                                              std::forward<Args>(args)...));
+        }
+
+        auto index = find_slot(key);
+        if (index != _size) {
+            return { iterator(_slots + index), false };
+        }
+
+        if (_size == N) {
+            spill(N + 1);
+            return wrap(_spilled->try_emplace(std::forward<K>(key),
+                                              std::forward<Args>(args)...));
+        }
+
+        _slots[_size].construct(
+            std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { iterator(_slots + _size++), true };
+    }
+
+    // the mapped value is only used by one of the two calls
+    template <typename K, typename Mapped>
+    std::pair<iterator, bool> insert_or_assign_impl(K&& key,
+                                                    Mapped&& mapped) {
+        auto result =
+            try_emplace_impl(std::forward<K>(key), std::forward<Mapped>(mapped));
+        if (!result.second) {
+            result.first->second = std::forward<Mapped>(mapped);
+        }
+
+        return result;
+    }
+
+    std::pair<iterator, bool>
+    wrap(std::pair<typename dict_type::iterator, bool> result) {
+        return { iterator(result.first), result.second };
+    }
+
+    // Moves the inline elements into a dict with room for size_hint
+    // elements. Elements which can't be moved without throwing are copied,
+    // so a throw leaves them all in place.
+    void spill(size_type size_hint) {
+        std::unique_ptr<dict_type> spilled(
+            new dict_type(std::max(size_hint, 2 * N), _hasher, _key_equal,
+                          _alloc));
+        for (size_type index = 0; index != _size; ++index) {
+            auto& element = _slots[index].get().view;
+            spilled->try_emplace(std::move_if_noexcept(element.first),
+                                 std::move_if_noexcept(element.second));
+        }
+
+        destroy_slots();
+        _size = 0;
+        _spilled = std::move(spilled);
+    }
+
+    void erase_slot(size_type index) {
+        const auto last = _size - 1;
+        if (index != last) {
+            _slots[index].destroy();
+            _slots[index].construct(std::move(_slots[last].get()));
+        }
+
+        _slots[last].destroy();
+        --_size;
+    }
+
+    void destroy_slots() noexcept {
+        for (size_type index = 0; index != _size; ++index) {
+            _slots[index].destroy();
+        }
+    }
+
+    // leaves other empty and inline
+    void take_elements(small_dict& other) {
+        _spilled = std::move(other._spilled);
+        for (; _size != other._size; ++_size) {
+            _slots[_size].construct(std::move(other._slots[_size].get()));
+        }
+        other.clear();
+    }
+
+    slot _slots[N];
+    size_type _size;
+    std::unique_ptr<dict_type> _spilled;
+    Hasher _hasher;
+    KeyEqual _key_equal;
+    Allocator _alloc;
+};
+
+template <typename Key, typename Value, std::size_t N, typename Hasher,
+          typename KeyEqual, typename Allocator, typename Storage>
+void swap(small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& A,
+          small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& B) {
+    A.swap(B);
+}
+
+template <typename Key, typename Value, std::size_t N, typename Hasher,
+          typename KeyEqual, typename Allocator, typename Storage,
+          typename Predicate>
+typename small_dict<Key, Value, N, Hasher, KeyEqual, Allocator,
+                    Storage>::size_type
+erase_if(small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& d,
+         Predicate pred) {
+    return d.erase_if(pred);
+}
+
+template <typename Key, typename Value, std::size_t N, typename Hasher,
+          typename KeyEqual, typename Allocator, typename Storage>
+bool operator==(
+    const small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& A,
+    const small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& B) {
+    if (A.size() != B.size()) {
+        return false;
+    }
+
+    for (const auto& elem : A) {
+        auto res = B.find(elem.first);
+
+        if (res == B.end() || res->second != elem.second) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Key, typename Value, std::size_t N, typename Hasher,
+          typename KeyEqual, typename Allocator, typename Storage>
+bool operator!=(
+    const small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& A,
+    const small_dict<Key, Value, N, Hasher, KeyEqual, Allocator, Storage>& B) {
+    return !(A == B);
+}
+
+} // namespace io
+
+#endif
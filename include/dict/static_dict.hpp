@@ -0,0 +1,366 @@
+#ifndef DICT_STATIC_DICT_HPP
+#define DICT_STATIC_DICT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "detail/math_util.hpp"
+
+// needs C++14's relaxed constexpr to build the table at compile time
+#if __cpp_constexpr >= 201304 && __cpp_lib_integer_sequence
+
+namespace io {
+
+// A string which can be a key of a constexpr static_dict. It doesn't own its
+// characters, the ones of a static_dict are string literals.
+class static_string {
+public:
+    constexpr static_string() : _data(""), _size(0) {}
+    constexpr static_string(const char* data)
+        : _data(data), _size(length(data)) {}
+    constexpr static_string(const char* data, std::size_t size)
+        : _data(data), _size(size) {}
+    static_string(const std::string& str)
+        : _data(str.data()), _size(str.size()) {}
+
+    constexpr const char* data() const { return _data; }
+
+    constexpr std::size_t size() const { return _size; }
+
+    std::string str() const { return std::string(_data, _size); }
+
+    constexpr bool operator==(const static_string& other) const {
+        if (_size != other._size) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i != _size; ++i) {
+            if (_data[i] != other._data[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    constexpr bool operator!=(const static_string& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static constexpr std::size_t length(const char* data) {
+        std::size_t size = 0;
+        while (data[size] != '\0') {
+            ++size;
+        }
+        return size;
+    }
+
+    const char* _data;
+    std::size_t _size;
+};
+
+// constexpr hash for the keys of a static_dict: integers and enums go
+// through murmur3's finaliser
+template <typename Key>
+struct static_hash {
+    static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value,
+                  "static_hash needs a specialisation for this key type");
+
+    constexpr std::size_t operator()(const Key& key) const {
+        return detail::mix_bits(static_cast<std::uint64_t>(key));
+    }
+};
+
+// FNV-1a over the characters, mixed like the integers
+template <>
+struct static_hash<static_string> {
+    constexpr std::size_t operator()(const static_string& key) const {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (std::size_t i = 0; i != key.size(); ++i) {
+            hash ^= static_cast<unsigned char>(key.data()[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return detail::mix_bits(hash);
+    }
+};
+
+namespace detail {
+
+constexpr std::size_t static_power_of_two(std::size_t value,
+                                          std::size_t power = 1) {
+    return power >= value ? power : static_power_of_two(value, 2 * power);
+}
+
+constexpr unsigned static_log2(std::size_t power_of_two) {
+    return power_of_two == 1 ? 0 : 1 + static_log2(power_of_two / 2);
+}
+
+// buckets of about four keys, each with its own pilot
+constexpr std::size_t static_bucket_count(std::size_t size) {
+    return static_power_of_two((size + 3) / 4);
+}
+
+// at most half of the slots are used so pilots are found quickly
+constexpr std::size_t static_slot_count(std::size_t size) {
+    return static_power_of_two(2 * size);
+}
+
+// the smallest unsigned type which can index size entries
+template <std::size_t Size>
+using static_index = typename std::conditional<
+    Size <= std::numeric_limits<std::uint8_t>::max() + 1, std::uint8_t,
+    typename std::conditional<
+        Size <= std::numeric_limits<std::uint16_t>::max() + 1, std::uint16_t,
+        std::uint32_t>::type>::type;
+
+constexpr std::uint64_t static_golden_ratio() { return 0x9e3779b97f4a7c15ull; }
+
+constexpr std::size_t static_slot_index(std::size_t hash, std::uint64_t seed,
+                                        unsigned slot_bits) {
+    return std::size_t(((hash ^ seed) * static_golden_ratio()) >>
+                       (64 - slot_bits));
+}
+
+template <std::size_t Size>
+struct static_layout {
+    // per bucket, mixed into the hash before picking the slot
+    std::uint64_t seeds[static_bucket_count(Size)];
+    // the entry in each slot, empty slots name entry 0
+    std::size_t entries[static_slot_count(Size)];
+};
+
+// Searches a seed for each bucket, largest first, which sends all keys of the
+// bucket to free slots, as frozen_dict does at runtime.
+template <typename Key, typename Value, std::size_t Size, typename Hasher,
+          typename KeyEqual>
+constexpr static_layout<Size>
+make_static_layout(const std::pair<Key, Value> (&init)[Size],
+                   const Hasher& hasher, const KeyEqual& key_equal) {
+    constexpr auto bucket_count = static_bucket_count(Size);
+    constexpr auto slot_count = static_slot_count(Size);
+    constexpr auto slot_bits = static_log2(slot_count);
+
+    std::size_t hashes[Size] = {};
+    std::size_t bucket_starts[bucket_count + 1] = {};
+    for (std::size_t i = 0; i != Size; ++i) {
+        hashes[i] = hasher(init[i].first);
+        ++bucket_starts[(hashes[i] & (bucket_count - 1)) + 1];
+    }
+
+    std::size_t largest_bucket = 0;
+    for (std::size_t bucket = 0; bucket != bucket_count; ++bucket) {
+        if (bucket_starts[bucket + 1] > largest_bucket) {
+            largest_bucket = bucket_starts[bucket + 1];
+        }
+        bucket_starts[bucket + 1] += bucket_starts[bucket];
+    }
+
+    // the keys grouped by bucket, sorted by hash within a bucket so that keys
+    // no seed can separate end up next to each other
+    std::size_t keys[Size] = {};
+    std::size_t filled[bucket_count] = {};
+    for (std::size_t i = 0; i != Size; ++i) {
+        const auto bucket = hashes[i] & (bucket_count - 1);
+        auto pos = bucket_starts[bucket] + filled[bucket]++;
+        for (; pos != bucket_starts[bucket] && hashes[keys[pos - 1]] > hashes[i];
+             --pos) {
+            keys[pos] = keys[pos - 1];
+        }
+        keys[pos] = i;
+
+        if (pos != bucket_starts[bucket] &&
+            hashes[keys[pos - 1]] == hashes[i]) {
+            if (key_equal(init[keys[pos - 1]].first, init[i].first)) {
+                throw std::invalid_argument("Duplicate key in static_dict");
+            }
+            throw std::invalid_argument(
+                "Keys with equal hashes can't be perfectly hashed");
+        }
+    }
+
+    static_layout<Size> layout{};
+    bool taken[slot_count] = {};
+    for (auto size = largest_bucket; size != 0; --size) {
+        for (std::size_t bucket = 0; bucket != bucket_count; ++bucket) {
+            const auto first = bucket_starts[bucket];
+            const auto last = bucket_starts[bucket + 1];
+            if (last - first != size) {
+                continue;
+            }
+
+            for (std::uint64_t pilot = 0;; ++pilot) {
+                if (pilot > std::numeric_limits<std::uint32_t>::max()) {
+                    throw std::runtime_error("No perfect hash found");
+                }
+
+                const auto seed = pilot * static_golden_ratio();
+                auto placed = first;
+                for (; placed != last; ++placed) {
+                    auto index =
+                        static_slot_index(hashes[keys[placed]], seed, slot_bits);
+                    if (taken[index]) {
+                        break;
+                    }
+                    taken[index] = true;
+                }
+
+                if (placed == last) {
+                    layout.seeds[bucket] = seed;
+                    break;
+                }
+
+                for (auto key = first; key != placed; ++key) {
+                    taken[static_slot_index(hashes[keys[key]], seed,
+                                            slot_bits)] = false;
+                }
+            }
+
+            for (auto key = first; key != last; ++key) {
+                layout.entries[static_slot_index(
+                    hashes[keys[key]], layout.seeds[bucket], slot_bits)] =
+                    keys[key];
+            }
+        }
+    }
+
+    return layout;
+}
+
+} // namespace detail
+
+// An immutable map whose keys are known at compile time. It is built in a
+// constexpr context, so the perfect hash is searched by the compiler and the
+// whole table ends up in read only data without any startup cost.
+//
+// Keys are split into buckets by their hash and every bucket gets a seed
+// which sends its keys to distinct slots of a table with twice as many slots
+// as keys. A slot holds the index of its entry, free slots that of the first
+// entry, which has a slot of its own and thus never matches a key hashed
+// there. A lookup therefore hashes, mixes in the seed, shifts and compares
+// exactly one key. Hasher and KeyEqual need constexpr call operators and
+// the hash has to be well mixed, as static_hash is.
+template <typename Key, typename Value, std::size_t N,
+          typename Hasher = static_hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class static_dict {
+    static_assert(N != 0, "a static_dict needs at least one element");
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using hasher = Hasher;
+    using key_equal = KeyEqual;
+
+    using value_type = std::pair<const Key, Value>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using const_reference = const value_type&;
+
+    // elements are in the order they were given and can't be changed
+    using iterator = const value_type*;
+    using const_iterator = const value_type*;
+
+    constexpr explicit static_dict(const std::pair<Key, Value> (&init)[N],
+                                   const Hasher& hash = Hasher(),
+                                   const KeyEqual& key_equal = KeyEqual())
+        : static_dict(init, detail::make_static_layout(init, hash, key_equal),
+                      hash, key_equal, std::make_index_sequence<N>(),
+                      std::make_index_sequence<bucket_count>(),
+                      std::make_index_sequence<slot_count>()) {}
+
+    constexpr const_iterator begin() const noexcept { return _entries; }
+
+    constexpr const_iterator end() const noexcept { return _entries + N; }
+
+    constexpr const_iterator cbegin() const noexcept { return begin(); }
+
+    constexpr const_iterator cend() const noexcept { return end(); }
+
+    constexpr bool empty() const noexcept { return false; }
+
+    constexpr size_type size() const noexcept { return N; }
+
+    constexpr const_iterator find(const Key& key) const {
+        const auto hash = _hasher(key);
+        const auto& entry =
+            _entries[_slots[detail::static_slot_index(
+                hash, _seeds[hash & (bucket_count - 1)], slot_bits)]];
+        return _key_equal(entry.first, key) ? &entry : end();
+    }
+
+    constexpr bool contains(const Key& key) const { return find(key) != end(); }
+
+    constexpr size_type count(const Key& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr const Value& at(const Key& key) const {
+        auto iter = find(key);
+        if (iter == end()) {
+            throw std::out_of_range("Key not in dict");
+        }
+
+        return iter->second;
+    }
+
+    constexpr std::pair<const_iterator, const_iterator>
+    equal_range(const Key& key) const {
+        auto iter = find(key);
+        return { iter, iter == end() ? iter : iter + 1 };
+    }
+
+    constexpr hasher hash_function() const { return _hasher; }
+
+    constexpr key_equal key_eq() const { return _key_equal; }
+
+private:
+    static constexpr size_type bucket_count = detail::static_bucket_count(N);
+    static constexpr size_type slot_count = detail::static_slot_count(N);
+    static constexpr unsigned slot_bits = detail::static_log2(slot_count);
+
+    using index_type = detail::static_index<N>;
+
+    template <std::size_t... Entries, std::size_t... Buckets,
+              std::size_t... Slots>
+    constexpr static_dict(const std::pair<Key, Value> (&init)[N],
+                          const detail::static_layout<N>& layout,
+                          const Hasher& hash, const KeyEqual& key_equal,
+                          std::index_sequence<Entries...>,
+                          std::index_sequence<Buckets...>,
+                          std::index_sequence<Slots...>)
+        : _entries{ value_type(init[Entries])... },
+          _seeds{ layout.seeds[Buckets]... },
+          _slots{ index_type(layout.entries[Slots])... }, _hasher(hash),
+          _key_equal(key_equal) {}
+
+    value_type _entries[N];
+    std::uint64_t _seeds[bucket_count];
+    index_type _slots[slot_count];
+    Hasher _hasher;
+    KeyEqual _key_equal;
+};
+
+// Deduces the number of elements, e.g.
+//     constexpr auto keywords =
+//         io::make_static_dict<io::static_string, int>({{"if", 1}, ...});
+template <typename Key, typename Value, typename Hasher = static_hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, std::size_t N>
+constexpr static_dict<Key, Value, N, Hasher, KeyEqual>
+make_static_dict(const std::pair<Key, Value> (&init)[N],
+                 const Hasher& hash = Hasher(),
+                 const KeyEqual& key_equal = KeyEqual()) {
+    return static_dict<Key, Value, N, Hasher, KeyEqual>(init, hash, key_equal);
+}
+
+} // namespace io
+
+#endif
+
+#endif
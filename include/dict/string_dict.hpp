@@ -0,0 +1,484 @@
+#ifndef DICT_STRING_DICT_HPP
+#define DICT_STRING_DICT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#if __cpp_lib_string_view
+#include <string_view>
+#endif
+
+#include "dict.hpp"
+#include "detail/math_util.hpp"
+
+namespace io {
+
+// the characters of a key passed to a string_dict, they aren't copied
+class string_key_view {
+public:
+    string_key_view(const char* data, std::size_t size)
+        : _data(data), _size(size) {}
+    string_key_view(const char* str) : string_key_view(str, std::strlen(str)) {}
+    string_key_view(const std::string& str)
+        : string_key_view(str.data(), str.size()) {}
+#if __cpp_lib_string_view
+    string_key_view(std::string_view str)
+        : string_key_view(str.data(), str.size()) {}
+#endif
+
+    const char* data() const noexcept { return _data; }
+
+    std::size_t size() const noexcept { return _size; }
+
+private:
+    const char* _data;
+    std::size_t _size;
+};
+
+namespace detail {
+
+// Bump allocator for the characters of long keys. Blocks double in size up
+// to max_block_bytes(), longer keys get a block of their own. Characters of
+// erased keys are only counted, they are given back all at once by clear().
+class string_arena {
+public:
+    string_arena()
+        : _next(nullptr), _left(0), _block_bytes(min_block_bytes()),
+          _used(0), _wasted(0) {}
+
+    string_arena(string_arena&& other) noexcept
+        : _blocks(std::move(other._blocks)), _next(other._next),
+          _left(other._left), _block_bytes(other._block_bytes),
+          _used(other._used), _wasted(other._wasted) {
+        other._blocks.clear();
+        other.reset();
+    }
+
+    string_arena(const string_arena&) = delete;
+
+    string_arena& operator=(string_arena other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~string_arena() { clear(); }
+
+    void swap(string_arena& other) noexcept {
+        using std::swap;
+        swap(_blocks, other._blocks);
+        swap(_next, other._next);
+        swap(_left, other._left);
+        swap(_block_bytes, other._block_bytes);
+        swap(_used, other._used);
+        swap(_wasted, other._wasted);
+    }
+
+    // the copy stays where it is until clear()
+    const char* store(const char* data, std::size_t size) {
+        if (size > _left) {
+            add_block(size);
+        }
+
+        auto copy = _next;
+        std::memcpy(copy, data, size);
+        _next += size;
+        _left -= size;
+        _used += size;
+        return copy;
+    }
+
+    void release(std::size_t size) noexcept { _wasted += size; }
+
+    // characters of keys still in use
+    std::size_t used() const noexcept { return _used - _wasted; }
+
+    std::size_t wasted() const noexcept { return _wasted; }
+
+    void clear() noexcept {
+        for (auto block : _blocks) {
+            ::operator delete(block);
+        }
+        _blocks.clear();
+        reset();
+    }
+
+    static constexpr std::size_t min_block_bytes() { return 4096; }
+    static constexpr std::size_t max_block_bytes() { return 1 << 20; }
+
+private:
+    void reset() noexcept {
+        _next = nullptr;
+        _left = 0;
+        _block_bytes = min_block_bytes();
+        _used = 0;
+        _wasted = 0;
+    }
+
+    void add_block(std::size_t size) {
+        _blocks.reserve(_blocks.size() + 1);
+        auto bytes = std::max(size, _block_bytes);
+        _next = static_cast<char*>(::operator new(bytes));
+        _left = bytes;
+        _blocks.push_back(_next);
+
+        if (_block_bytes * 2 <= max_block_bytes()) {
+            _block_bytes *= 2;
+        }
+    }
+
+    std::vector<char*> _blocks;
+    char* _next;
+    std::size_t _left;
+    std::size_t _block_bytes;
+    std::size_t _used;
+    std::size_t _wasted;
+};
+
+constexpr std::size_t string_key_inline_capacity() { return 12; }
+
+// a key about to be inserted and the arena for its characters
+struct string_key_source {
+    string_key_view view;
+    string_arena* arena;
+};
+
+} // namespace detail
+
+// The key stored in a string_dict slot, 16 bytes. Keys of up to
+// inline_capacity() characters are stored right here. Longer keys keep a
+// prefix here and the rest lives in the dict's arena.
+class string_key {
+public:
+    explicit string_key(const detail::string_key_source& source)
+        : _size(checked_size(source.view.size())) {
+        const auto data = source.view.data();
+        if (!is_long()) {
+            std::memcpy(_chars, data, _size);
+            return;
+        }
+
+        std::memcpy(_chars, data, prefix_size());
+        const char* stored = source.arena->store(data, _size);
+        std::memcpy(_chars + prefix_size(), &stored, sizeof(stored));
+    }
+
+    static constexpr std::size_t inline_capacity() {
+        return detail::string_key_inline_capacity();
+    }
+
+    std::size_t size() const noexcept { return _size; }
+
+    bool is_long() const noexcept { return _size > inline_capacity(); }
+
+    // points into the key itself for short keys
+    const char* data() const noexcept {
+        if (!is_long()) {
+            return _chars;
+        }
+
+        const char* stored;
+        std::memcpy(&stored, _chars + prefix_size(), sizeof(stored));
+        return stored;
+    }
+
+    std::string str() const { return std::string(data(), _size); }
+
+    operator string_key_view() const { return string_key_view(data(), _size); }
+
+    // only reads the arena once size and prefix match
+    bool equals(const char* other, std::size_t size) const {
+        if (size != _size) {
+            return false;
+        }
+
+        if (!is_long()) {
+            return std::memcmp(_chars, other, _size) == 0;
+        }
+
+        return std::memcmp(_chars, other, prefix_size()) == 0 &&
+               std::memcmp(data(), other, _size) == 0;
+    }
+
+    bool operator==(string_key_view other) const {
+        return equals(other.data(), other.size());
+    }
+
+    bool operator!=(string_key_view other) const { return !(*this == other); }
+
+private:
+    static constexpr std::size_t prefix_size() {
+        return inline_capacity() - sizeof(const char*);
+    }
+
+    static std::uint32_t checked_size(std::size_t size) {
+        if (size > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("Key too long for string_dict");
+        }
+
+        return std::uint32_t(size);
+    }
+
+    // all characters of a short key, the prefix and the arena pointer of a
+    // long one
+    char _chars[detail::string_key_inline_capacity()];
+    std::uint32_t _size;
+};
+
+namespace detail {
+
+struct string_key_hash {
+    using is_transparent = void;
+
+    std::size_t operator()(string_key_view key) const {
+        return hash_bytes(key.data(), key.size());
+    }
+
+    std::size_t operator()(const string_key& key) const {
+        return (*this)(string_key_view(key));
+    }
+
+    std::size_t operator()(const string_key_source& key) const {
+        return (*this)(key.view);
+    }
+};
+
+} // namespace detail
+
+// probes compare the cached hash before reading any characters
+template <>
+struct cache_hash<string_key, detail::string_key_hash> : std::true_type {};
+
+namespace detail {
+
+struct string_key_equal {
+    using is_transparent = void;
+
+    bool operator()(const string_key& lhs, string_key_view rhs) const {
+        return lhs.equals(rhs.data(), rhs.size());
+    }
+
+    bool operator()(const string_key& lhs, const string_key& rhs) const {
+        return lhs.equals(rhs.data(), rhs.size());
+    }
+
+    bool operator()(const string_key& lhs,
+                    const string_key_source& rhs) const {
+        return (*this)(lhs, rhs.view);
+    }
+};
+
+} // namespace detail
+
+// A dict for string keys. A slot holds the size, the cached hash and up to
+// 12 characters of its key, longer keys put their characters into an arena
+// owned by the dict. Probing compares hashes first and only reads characters
+// once the size matches as well, so a lookup touches the arena at most once.
+// Lookups and inserts take anything convertible to string_key_view, the
+// characters are only copied when a key is inserted.
+//
+// Erasing long keys leaves their characters in the arena. Once more than
+// half of it is unused, erase(key) copies the dict into a fresh arena.
+template <typename Value,
+          typename Allocator = std::allocator<std::pair<const string_key, Value>>,
+          typename Storage = inline_flag_storage>
+class string_dict {
+public:
+    using dict_type = dict<string_key, Value, detail::string_key_hash,
+                           detail::string_key_equal, Allocator, Storage>;
+
+    using key_type = string_key;
+    using mapped_type = Value;
+    using allocator_type = Allocator;
+    using value_type = typename dict_type::value_type;
+    using size_type = typename dict_type::size_type;
+    using difference_type = typename dict_type::difference_type;
+    using reference = value_type&;
+    using iterator = typename dict_type::iterator;
+    using const_iterator = typename dict_type::const_iterator;
+
+    string_dict() = default;
+
+    explicit string_dict(size_type initial_size,
+                         const Allocator& alloc = Allocator())
+        : _dict(initial_size, detail::string_key_hash(),
+                detail::string_key_equal(), alloc) {}
+
+    string_dict(std::initializer_list<std::pair<string_key_view, Value>> init)
+        : string_dict(init.size()) {
+        for (const auto& element : init) {
+            try_emplace(element.first, element.second);
+        }
+    }
+
+    explicit string_dict(const Allocator& alloc)
+        : _dict(alloc) {}
+
+    // the copy stores the long keys in an arena of its own, a dict needs at
+    // least one slot
+    string_dict(const string_dict& other, const Allocator& alloc)
+        : string_dict(std::max(other.size(), size_type(1)), alloc) {
+        for (const auto& element : other) {
+            try_emplace(element.first, element.second);
+        }
+    }
+
+    string_dict(const string_dict& other)
+        : string_dict(other, std::allocator_traits<Allocator>::
+                                 select_on_container_copy_construction(
+                                     other.get_allocator())) {}
+
+    string_dict(string_dict&& other) = default;
+
+    // the copy already has the allocator this dict is left with, so moving
+    // it in never mixes allocators
+    string_dict& operator=(const string_dict& other) {
+        if (this != &other) {
+            *this = string_dict(
+                other, std::allocator_traits<Allocator>::
+                               propagate_on_container_copy_assignment::value
+                           ? other.get_allocator()
+                           : get_allocator());
+        }
+        return *this;
+    }
+
+    string_dict& operator=(string_dict&& other) = default;
+
+    allocator_type get_allocator() const { return _dict.get_allocator(); }
+
+    iterator begin() noexcept { return _dict.begin(); }
+
+    const_iterator begin() const noexcept { return _dict.begin(); }
+
+    const_iterator cbegin() const noexcept { return _dict.cbegin(); }
+
+    iterator end() noexcept { return _dict.end(); }
+
+    const_iterator end() const noexcept { return _dict.end(); }
+
+    const_iterator cend() const noexcept { return _dict.cend(); }
+
+    size_type size() const noexcept { return _dict.size(); }
+
+    bool empty() const noexcept { return _dict.empty(); }
+
+    // characters of long keys kept in the arena, erased ones included
+    std::size_t arena_bytes() const noexcept {
+        return _arena.used() + _arena.wasted();
+    }
+
+    float load_factor() const { return _dict.load_factor(); }
+
+    float max_load_factor() const { return _dict.max_load_factor(); }
+
+    void max_load_factor(float new_max_load_factor) {
+        _dict.max_load_factor(new_max_load_factor);
+    }
+
+    void reserve(size_type size) { _dict.reserve(size); }
+
+    void clear() {
+        _dict.clear();
+        _arena.clear();
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(string_key_view key,
+                                          Args&&... args) {
+        return _dict.try_emplace(source(key), std::forward<Args>(args)...);
+    }
+
+    template <typename Mapped>
+    std::pair<iterator, bool> insert_or_assign(string_key_view key,
+                                               Mapped&& mapped) {
+        auto result = try_emplace(key, std::forward<Mapped>(mapped));
+        if (!result.second) {
+            result.first->second = std::forward<Mapped>(mapped);
+        }
+
+        return result;
+    }
+
+    Value& operator[](string_key_view key) {
+        return _dict[source(key)];
+    }
+
+    iterator find(string_key_view key) { return _dict.find(key); }
+
+    const_iterator find(string_key_view key) const { return _dict.find(key); }
+
+    size_type count(string_key_view key) const { return _dict.count(key); }
+
+    Value& at(string_key_view key) { return _dict.at(key); }
+
+    const Value& at(string_key_view key) const { return _dict.at(key); }
+
+    size_type erase(string_key_view key) {
+        auto iter = _dict.find(key);
+        if (iter == _dict.end()) {
+            return 0;
+        }
+
+        erase(iter);
+        if (_arena.wasted() > std::max(_arena.used(),
+                                       detail::string_arena::min_block_bytes())) {
+            *this = string_dict(*this, get_allocator());
+        }
+
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) {
+        if (pos->first.is_long()) {
+            _arena.release(pos->first.size());
+        }
+
+        return _dict.erase(pos);
+    }
+
+    void swap(string_dict& other) {
+        _dict.swap(other._dict);
+        _arena.swap(other._arena);
+    }
+
+    const dict_type& as_dict() const noexcept { return _dict; }
+
+private:
+    detail::string_key_source source(string_key_view key) {
+        return { key, &_arena };
+    }
+
+    dict_type _dict;
+    detail::string_arena _arena;
+};
+
+template <typename Value, typename Allocator, typename Storage>
+void swap(string_dict<Value, Allocator, Storage>& A,
+          string_dict<Value, Allocator, Storage>& B) {
+    A.swap(B);
+}
+
+template <typename Value, typename Allocator, typename Storage>
+bool operator==(const string_dict<Value, Allocator, Storage>& A,
+                const string_dict<Value, Allocator, Storage>& B) {
+    return A.as_dict() == B.as_dict();
+}
+
+template <typename Value, typename Allocator, typename Storage>
+bool operator!=(const string_dict<Value, Allocator, Storage>& A,
+                const string_dict<Value, Allocator, Storage>& B) {
+    return !(A == B);
+}
+
+} // namespace io
+
+#endif
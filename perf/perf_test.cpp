@@ -1,10 +1,25 @@
+#include "../include/dict/concurrent_dict.hpp"
+#include "../include/dict/read_mostly_dict.hpp"
 #include "../include/dict/dict.hpp"
+#include "../include/dict/frozen_dict.hpp"
+#include "../include/dict/huge_page_allocator.hpp"
+#include "../include/dict/mapped_dict.hpp"
+#include "../include/dict/node_dict.hpp"
+#include "../include/dict/recycling_resource.hpp"
+#include "../include/dict/small_dict.hpp"
+#include "../include/dict/static_dict.hpp"
+#include "../include/dict/string_dict.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <functional>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <unordered_map>
 #include <array>
+#include <vector>
 
 #ifdef WITH_GOOGLE_BENCH
 #include <sparsehash/dense_hash_map>
@@ -33,6 +48,7 @@ BENCHMARK(murmur_hash_mixer);
 
 #define BENCH_SIZES ->Arg(8)->Arg(8 << 10)->Arg(8 << 14)->Arg(8 << 20)
 #define COLLISION_BENCH_SIZES ->Arg(8)->Arg(8 << 5)->Arg(8 << 10)
+#define GROW_BENCH_SIZES ->Arg(8 << 10)->Arg(8 << 14)->Arg(8 << 18)
 
 struct inc_gen {
     std::size_t operator()() { return _counter++; }
@@ -78,6 +94,23 @@ static void dict_insert(benchmark::State& state) {
 BENCHMARK(dict_insert)
 BENCH_SIZES;
 
+static void dict_robin_hood_insert(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    io::dict<std::size_t, std::size_t, std::hash<std::size_t>,
+             std::equal_to<std::size_t>,
+             std::allocator<std::pair<const std::size_t, std::size_t>>,
+             io::robin_hood_storage> d;
+    d.reserve(test_size);
+
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+
+    insert_test(state, d, gen);
+}
+BENCHMARK(dict_robin_hood_insert)
+BENCH_SIZES;
+
 static void umap_insert(benchmark::State& state) {
     const std::size_t test_size = state.range(0);
     std::unordered_map<std::size_t, std::size_t> d;
@@ -121,6 +154,55 @@ BENCHMARK(goog_insert)
 BENCH_SIZES;
 #endif
 
+// Grows a map from empty and reports its slowest single insert, the median
+// over all iterations so that scheduling hiccups don't dominate the result.
+template <typename Map>
+void grow_test(benchmark::State& state, const Map& empty_map) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+
+    std::vector<double> worst_inserts;
+    for (auto __attribute__((unused)) _ : state) {
+        auto map = empty_map;
+        double worst_insert = 0;
+        for (std::size_t i = 0; i != test_size; ++i) {
+            auto key = normal(engine);
+            auto start = std::chrono::steady_clock::now();
+            map[key] = i;
+            std::chrono::duration<double, std::micro> insert_time =
+                std::chrono::steady_clock::now() - start;
+            worst_insert = std::max(worst_insert, insert_time.count());
+        }
+        benchmark::DoNotOptimize(map.size());
+        worst_inserts.push_back(worst_insert);
+    }
+
+    auto median = worst_inserts.begin() + worst_inserts.size() / 2;
+    std::nth_element(worst_inserts.begin(), median, worst_inserts.end());
+    state.counters["worst_insert_us"] = *median;
+}
+
+static void dict_grow(benchmark::State& state) {
+    grow_test(state, io::dict<std::size_t, std::size_t>());
+}
+BENCHMARK(dict_grow)
+GROW_BENCH_SIZES;
+
+static void dict_grow_incremental_rehash(benchmark::State& state) {
+    io::dict<std::size_t, std::size_t> d;
+    d.rehash_step(64);
+    grow_test(state, d);
+}
+BENCHMARK(dict_grow_incremental_rehash)
+GROW_BENCH_SIZES;
+
+static void umap_grow(benchmark::State& state) {
+    grow_test(state, std::unordered_map<std::size_t, std::size_t>());
+}
+BENCHMARK(umap_grow)
+GROW_BENCH_SIZES;
+
 #ifdef WITH_GOOGLE_BENCH
 template <typename Map, typename Gen>
 Map build_map_google(std::size_t size, Gen gen) {
@@ -158,6 +240,281 @@ Map build_map(std::size_t size, Gen gen) {
     return d;
 }
 
+// rebuilds a map into a four times bigger table with the given thread count
+static void dict_reserve(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    const std::size_t threads = state.range(1);
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto prototype = build_map<io::dict<std::size_t, std::size_t>>(test_size, gen);
+
+    for (auto __attribute__((unused)) _ : state) {
+        state.PauseTiming();
+        auto d = prototype;
+        state.ResumeTiming();
+        d.reserve(4 * test_size, threads);
+    }
+}
+BENCHMARK(dict_reserve)
+    ->Args({8 << 14, 1})->Args({8 << 14, 4})
+    ->Args({8 << 20, 1})->Args({8 << 20, 4});
+
+// builds a map from a vector of random elements
+template <typename Map>
+void range_construct_test(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+    std::vector<std::pair<std::size_t, std::size_t>> elements(test_size);
+    for (auto& element : elements) {
+        element = { normal(engine), 1 };
+    }
+
+    for (auto __attribute__((unused)) _ : state) {
+        Map d(elements.begin(), elements.end());
+        benchmark::DoNotOptimize(d.size());
+    }
+}
+
+static void dict_range_construct(benchmark::State& state) {
+    range_construct_test<io::dict<std::size_t, std::size_t>>(state);
+}
+BENCHMARK(dict_range_construct)
+BENCH_SIZES;
+
+static void umap_range_construct(benchmark::State& state) {
+    range_construct_test<std::unordered_map<std::size_t, std::size_t>>(state);
+}
+BENCHMARK(umap_range_construct)
+BENCH_SIZES;
+
+// erases 30% of the elements of a map of random keys, all at once with
+// erase_if or one key after the other in random order
+static void dict_erase_if(benchmark::State& state) {
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto prototype =
+        build_map<io::dict<std::size_t, std::size_t>>(state.range(0), gen);
+
+    for (auto __attribute__((unused)) _ : state) {
+        state.PauseTiming();
+        auto d = prototype;
+        state.ResumeTiming();
+        d.erase_if([](const std::pair<const std::size_t, std::size_t>& e) {
+            return e.second % 10 < 3;
+        });
+    }
+}
+BENCHMARK(dict_erase_if)
+BENCH_SIZES;
+
+static void dict_erase_keys(benchmark::State& state) {
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto prototype =
+        build_map<io::dict<std::size_t, std::size_t>>(state.range(0), gen);
+
+    std::vector<std::size_t> keys;
+    for (const auto& e : prototype) {
+        if (e.second % 10 < 3) {
+            keys.push_back(e.first);
+        }
+    }
+    std::shuffle(keys.begin(), keys.end(), engine);
+
+    for (auto __attribute__((unused)) _ : state) {
+        state.PauseTiming();
+        auto d = prototype;
+        state.ResumeTiming();
+        for (auto key : keys) {
+            d.erase(key);
+        }
+    }
+}
+BENCHMARK(dict_erase_keys)
+BENCH_SIZES;
+
+// grows a map with heavy values from empty, through all its rehashes, and
+// erases every element again
+template <typename Map>
+void heavy_value_test(benchmark::State& state,
+                      const typename Map::mapped_type& value) {
+    std::uniform_int_distribution<std::size_t> normal;
+    std::mt19937 engine;
+    std::vector<std::size_t> keys(state.range(0));
+    for (auto& key : keys) {
+        key = normal(engine);
+    }
+
+    for (auto __attribute__((unused)) _ : state) {
+        Map map;
+        for (auto key : keys) {
+            map.emplace(key, value);
+        }
+        for (auto key : keys) {
+            map.erase(key);
+        }
+        benchmark::DoNotOptimize(map.size());
+    }
+}
+
+static void dict_string_values(benchmark::State& state) {
+    heavy_value_test<io::dict<std::size_t, std::string>>(state, "value");
+}
+BENCHMARK(dict_string_values)
+GROW_BENCH_SIZES;
+
+static void umap_string_values(benchmark::State& state) {
+    heavy_value_test<std::unordered_map<std::size_t, std::string>>(state,
+                                                                   "value");
+}
+BENCHMARK(umap_string_values)
+GROW_BENCH_SIZES;
+
+static void dict_vector_values(benchmark::State& state) {
+    heavy_value_test<io::dict<std::size_t, std::vector<std::size_t>>>(
+        state, std::vector<std::size_t>(4));
+}
+BENCHMARK(dict_vector_values)
+GROW_BENCH_SIZES;
+
+// 200 bytes, every rehash of a dict moves all of them
+using large_value = std::array<std::size_t, 25>;
+
+static void dict_large_values(benchmark::State& state) {
+    heavy_value_test<io::dict<std::size_t, large_value>>(state, large_value());
+}
+BENCHMARK(dict_large_values)
+GROW_BENCH_SIZES;
+
+static void node_dict_large_values(benchmark::State& state) {
+    heavy_value_test<io::node_dict<std::size_t, large_value>>(state,
+                                                              large_value());
+}
+BENCHMARK(node_dict_large_values)
+GROW_BENCH_SIZES;
+
+static void umap_large_values(benchmark::State& state) {
+    heavy_value_test<std::unordered_map<std::size_t, large_value>>(
+        state, large_value());
+}
+BENCHMARK(umap_large_values)
+GROW_BENCH_SIZES;
+
+// builds 1000 maps of state.range(0) elements and looks every key up, like
+// per-object attribute maps
+template <typename Map>
+void tiny_maps_test(benchmark::State& state) {
+    const std::size_t elements = state.range(0);
+    for (auto __attribute__((unused)) _ : state) {
+        std::vector<Map> maps(1000);
+        for (auto& map : maps) {
+            for (std::size_t i = 0; i != elements; ++i) {
+                map[i * 7] = i;
+            }
+        }
+
+        std::size_t sum = 0;
+        for (const auto& map : maps) {
+            for (std::size_t i = 0; i != elements; ++i) {
+                sum += map.find(i * 7)->second;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+#define TINY_BENCH_SIZES ->Arg(0)->Arg(2)->Arg(8)->Arg(16)
+
+static void dict_tiny_maps(benchmark::State& state) {
+    tiny_maps_test<io::dict<std::size_t, std::size_t>>(state);
+}
+BENCHMARK(dict_tiny_maps)
+TINY_BENCH_SIZES;
+
+static void small_dict_tiny_maps(benchmark::State& state) {
+    tiny_maps_test<io::small_dict<std::size_t, std::size_t, 8>>(state);
+}
+BENCHMARK(small_dict_tiny_maps)
+TINY_BENCH_SIZES;
+
+static void umap_tiny_maps(benchmark::State& state) {
+    tiny_maps_test<std::unordered_map<std::size_t, std::size_t>>(state);
+}
+BENCHMARK(umap_tiny_maps)
+TINY_BENCH_SIZES;
+
+// a request builds a few short lived dicts one after another, allocated
+// from an arena on the stack which spills to the heap once it's full
+#define REQUEST_DICTS 8
+#define REQUEST_ARENA_BYTES (1 << 16)
+#define REQUEST_BENCH_SIZES ->Arg(64)->Arg(512)
+
+template <typename Map, typename... Args>
+std::size_t request_dicts_test(std::size_t elements, Args... args) {
+    std::size_t found = 0;
+    for (std::size_t i = 0; i != REQUEST_DICTS; ++i) {
+        Map map(args...);
+        for (std::size_t key = 0; key != elements; ++key) {
+            map[key * 7] = key;
+        }
+        found += map.count(elements * 7 / 2);
+    }
+    return found;
+}
+
+static void dict_per_request(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(
+            request_dicts_test<io::dict<std::size_t, std::size_t>>(
+                state.range(0)));
+    }
+}
+BENCHMARK(dict_per_request)
+REQUEST_BENCH_SIZES;
+
+#if __cpp_lib_memory_resource
+using pmr_request_dict = io::pmr::dict<std::size_t, std::size_t>;
+
+static void pmr_dict_per_request_arena(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        alignas(std::max_align_t) char buffer[REQUEST_ARENA_BYTES];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+        benchmark::DoNotOptimize(request_dicts_test<pmr_request_dict>(
+            state.range(0), &arena));
+    }
+}
+BENCHMARK(pmr_dict_per_request_arena)
+REQUEST_BENCH_SIZES;
+
+static void pmr_dict_per_request_recycled(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        alignas(std::max_align_t) char buffer[REQUEST_ARENA_BYTES];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+        io::pmr::recycling_resource recycler(&arena);
+        benchmark::DoNotOptimize(request_dicts_test<pmr_request_dict>(
+            state.range(0), &recycler));
+    }
+}
+BENCHMARK(pmr_dict_per_request_recycled)
+REQUEST_BENCH_SIZES;
+
+static void pmr_dict_per_request_pool(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        alignas(std::max_align_t) char buffer[REQUEST_ARENA_BYTES];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+        std::pmr::unsynchronized_pool_resource pool(&arena);
+        benchmark::DoNotOptimize(request_dicts_test<pmr_request_dict>(
+            state.range(0), &pool));
+    }
+}
+BENCHMARK(pmr_dict_per_request_pool)
+REQUEST_BENCH_SIZES;
+#endif
+
 template <typename Map>
 Map build_map_with_reserve(std::size_t size) {
     Map d(size);
@@ -353,6 +710,52 @@ static void dict_lookup(benchmark::State& state) {
 BENCHMARK(dict_lookup)
 BENCH_SIZES;
 
+// the same table on transparent huge pages, which only kick in for tables
+// of at least one huge page
+static void dict_huge_page_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<io::dict<
+        std::size_t, std::size_t, std::hash<std::size_t>,
+        std::equal_to<std::size_t>,
+        io::huge_page_allocator<std::pair<const std::size_t, std::size_t>>>>(
+        test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_huge_page_lookup)
+BENCH_SIZES;
+
+static void dict_lookup_batch(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<io::dict<std::size_t, std::size_t>>(test_size, gen);
+
+    using iterator = io::dict<std::size_t, std::size_t>::iterator;
+    std::array<std::size_t, 100> lookup_vals;
+    std::array<iterator, 100> found;
+    for (auto __attribute__((unused)) _ : state) {
+        state.PauseTiming();
+        std::generate(lookup_vals.begin(), lookup_vals.end(), gen);
+        state.ResumeTiming();
+        d.find_batch(lookup_vals.begin(), lookup_vals.end(), found.begin());
+
+        std::size_t res = 0;
+        for (auto&& it: found) {
+            if (it != d.end()) {
+                res += it->second;
+            }
+        }
+        benchmark::DoNotOptimize(res);
+    }
+}
+BENCHMARK(dict_lookup_batch)
+BENCH_SIZES;
+
 static void dict_with_finalizer_lookup(benchmark::State& state) {
     const std::size_t test_size = state.range(0);
     std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
@@ -365,6 +768,205 @@ static void dict_with_finalizer_lookup(benchmark::State& state) {
 BENCHMARK(dict_with_finalizer_lookup)
 BENCH_SIZES;
 
+template <typename Storage, typename Hasher = std::hash<std::size_t>>
+using storage_dict =
+    io::dict<std::size_t, std::size_t, Hasher, std::equal_to<std::size_t>,
+             std::allocator<std::pair<const std::size_t, std::size_t>>, Storage>;
+
+using size_t_sentinel_storage = io::sentinel_storage<
+    io::empty_key<std::size_t, ~std::size_t(0)>>;
+
+// fills a scratch map reserved for many elements with a few and clears it
+template <typename Map>
+void sparse_clear_test(benchmark::State& state, Map map) {
+    for (auto __attribute__((unused)) _ : state) {
+        for (std::size_t i = 0; i != 3; ++i) {
+            map[i] = i;
+        }
+        map.clear();
+    }
+}
+
+static void dict_sparse_clear(benchmark::State& state) {
+    sparse_clear_test(state, io::dict<std::size_t, std::size_t>(state.range(0)));
+}
+BENCHMARK(dict_sparse_clear)
+BENCH_SIZES;
+
+static void dict_control_bytes_sparse_clear(benchmark::State& state) {
+    sparse_clear_test(
+        state, storage_dict<io::control_byte_storage>(state.range(0)));
+}
+BENCHMARK(dict_control_bytes_sparse_clear)
+BENCH_SIZES;
+
+static void dict_sentinel_sparse_clear(benchmark::State& state) {
+    sparse_clear_test(
+        state, storage_dict<size_t_sentinel_storage>(state.range(0)));
+}
+BENCHMARK(dict_sentinel_sparse_clear)
+BENCH_SIZES;
+
+static void umap_sparse_clear(benchmark::State& state) {
+    sparse_clear_test(
+        state, std::unordered_map<std::size_t, std::size_t>(state.range(0)));
+}
+BENCHMARK(umap_sparse_clear)
+BENCH_SIZES;
+
+static void dict_control_bytes_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<storage_dict<io::control_byte_storage>>(test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_control_bytes_lookup)
+BENCH_SIZES;
+
+static void dict_control_bytes_with_finalizer_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<storage_dict<io::control_byte_storage,
+        io::murmur_hash_mixer<std::hash<std::size_t>>>>(test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_control_bytes_with_finalizer_lookup)
+BENCH_SIZES;
+
+static void dict_bitmap_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<storage_dict<io::bitmap_storage>>(test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_bitmap_lookup)
+BENCH_SIZES;
+
+static void dict_sentinel_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<storage_dict<size_t_sentinel_storage>>(test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_sentinel_lookup)
+BENCH_SIZES;
+
+static void dict_robin_hood_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<storage_dict<io::robin_hood_storage>>(test_size, gen);
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_robin_hood_lookup)
+BENCH_SIZES;
+
+static void frozen_dict_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    io::frozen_dict<std::size_t, std::size_t> d(
+        build_map<io::dict<std::size_t, std::size_t>>(test_size, gen));
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(frozen_dict_lookup)
+BENCH_SIZES;
+
+// lookups straight on a dict file mapped into memory
+static void mapped_dict_lookup(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    const char* path = "perf_test_mapped.bin";
+    io::write_mapped_dict(
+        build_map<io::dict<std::size_t, std::size_t>>(test_size, gen), path);
+
+    {
+        io::mapped_dict<std::size_t, std::size_t> d(path);
+        lookup_test(state, d, gen);
+    }
+    std::remove(path);
+}
+BENCHMARK(mapped_dict_lookup)
+BENCH_SIZES;
+
+// the keywords of C, looked up among as many identifiers
+static constexpr auto c_keywords = io::make_static_dict<io::static_string, int>(
+    { { "auto", 0 }, { "break", 1 }, { "case", 2 }, { "char", 3 },
+      { "const", 4 }, { "continue", 5 }, { "default", 6 }, { "do", 7 },
+      { "double", 8 }, { "else", 9 }, { "enum", 10 }, { "extern", 11 },
+      { "float", 12 }, { "for", 13 }, { "goto", 14 }, { "if", 15 },
+      { "int", 16 }, { "long", 17 }, { "register", 18 }, { "return", 19 },
+      { "short", 20 }, { "signed", 21 }, { "sizeof", 22 }, { "static", 23 },
+      { "struct", 24 }, { "switch", 25 }, { "typedef", 26 }, { "union", 27 },
+      { "unsigned", 28 }, { "void", 29 }, { "volatile", 30 },
+      { "while", 31 } });
+
+template <typename Map>
+void keyword_lookup_test(benchmark::State& state, const Map& map) {
+    std::vector<std::string> identifiers;
+    for (const auto& keyword : c_keywords) {
+        identifiers.push_back(keyword.first.str());
+        identifiers.push_back(keyword.first.str() + "_");
+    }
+
+    std::uniform_int_distribution<std::size_t> normal(0,
+                                                      identifiers.size() - 1);
+    std::mt19937 engine;
+    std::array<io::static_string, 100> tokens;
+    for (auto& token : tokens) {
+        token = identifiers[normal(engine)];
+    }
+
+    for (auto __attribute__((unused)) _ : state) {
+        int sum = 0;
+        for (const auto& token : tokens) {
+            auto iter = map.find(token);
+            sum += iter == map.end() ? -1 : iter->second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static void static_dict_keyword_lookup(benchmark::State& state) {
+    keyword_lookup_test(state, c_keywords);
+}
+BENCHMARK(static_dict_keyword_lookup);
+
+static void frozen_dict_keyword_lookup(benchmark::State& state) {
+    keyword_lookup_test(
+        state,
+        io::frozen_dict<io::static_string, int,
+                        io::static_hash<io::static_string>>(
+            c_keywords.begin(), c_keywords.end()));
+}
+BENCHMARK(frozen_dict_keyword_lookup);
+
+static void dict_keyword_lookup(benchmark::State& state) {
+    keyword_lookup_test(
+        state, io::dict<io::static_string, int,
+                        io::static_hash<io::static_string>>(
+                   c_keywords.begin(), c_keywords.end()));
+}
+BENCHMARK(dict_keyword_lookup);
+
 static void umap_lookup(benchmark::State& state) {
     const std::size_t test_size = state.range(0);
     std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
@@ -419,6 +1021,38 @@ static void dict_lookup_with_many_misses(benchmark::State& state) {
 BENCHMARK(dict_lookup_with_many_misses)
 BENCH_SIZES;
 
+static void dict_control_bytes_lookup_with_many_misses(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> build_normal(0, test_size - 1);
+    std::mt19937 build_engine;
+    auto build_gen = std::bind(std::ref(build_normal), std::ref(build_engine));
+    auto d = build_map<storage_dict<io::control_byte_storage>>(test_size, build_gen);
+
+    std::uniform_int_distribution<std::size_t> normal(0, 16 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_control_bytes_lookup_with_many_misses)
+BENCH_SIZES;
+
+static void dict_robin_hood_lookup_with_many_misses(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> build_normal(0, test_size - 1);
+    std::mt19937 build_engine;
+    auto build_gen = std::bind(std::ref(build_normal), std::ref(build_engine));
+    auto d = build_map<storage_dict<io::robin_hood_storage>>(test_size, build_gen);
+
+    std::uniform_int_distribution<std::size_t> normal(0, 16 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_robin_hood_lookup_with_many_misses)
+BENCH_SIZES;
+
 static void umap_lookup_with_many_misses(benchmark::State& state) {
     const std::size_t test_size = state.range(0);
     std::uniform_int_distribution<std::size_t> build_normal(0, test_size - 1);
@@ -484,6 +1118,47 @@ static void dict_lookup_with_heavy_clustering(benchmark::State& state) {
 BENCHMARK(dict_lookup_with_heavy_clustering)
 BENCH_SIZES;
 
+// one scan of the table as a metrics exporter would run it
+static void dict_stats(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    std::uniform_int_distribution<std::size_t> normal(0, 2 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+    auto d = build_map<io::dict<std::size_t, std::size_t>>(test_size, gen);
+
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(d.stats());
+    }
+}
+BENCHMARK(dict_stats)
+BENCH_SIZES;
+
+static void dict_control_bytes_lookup_with_heavy_clustering(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    auto d = build_map<storage_dict<io::control_byte_storage>>(test_size, inc_gen());
+
+    std::uniform_int_distribution<std::size_t> normal(0, 16 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_control_bytes_lookup_with_heavy_clustering)
+BENCH_SIZES;
+
+static void dict_robin_hood_lookup_with_heavy_clustering(benchmark::State& state) {
+    const std::size_t test_size = state.range(0);
+    auto d = build_map<storage_dict<io::robin_hood_storage>>(test_size, inc_gen());
+
+    std::uniform_int_distribution<std::size_t> normal(0, 16 * test_size - 1);
+    std::mt19937 engine;
+    auto gen = std::bind(std::ref(normal), std::ref(engine));
+
+    lookup_test(state, d, gen);
+}
+BENCHMARK(dict_robin_hood_lookup_with_heavy_clustering)
+BENCH_SIZES;
+
 static void umap_lookup_with_heavy_clustering(benchmark::State& state) {
     const std::size_t test_size = state.range(0);
     auto d = build_map<std::unordered_map<std::size_t, std::size_t>>(test_size, inc_gen());
@@ -651,6 +1326,30 @@ static void dict_build_string_keys(benchmark::State& state) {
 }
 BENCHMARK(dict_build_string_keys);
 
+struct uncached_string_hash : std::hash<std::string> {};
+
+namespace io {
+template <>
+struct cache_hash<std::string, uncached_string_hash> : std::false_type {};
+} // namespace io
+
+static void dict_build_string_keys_without_hash_cache(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(
+            build_string_map<io::dict<std::string, std::size_t, uncached_string_hash>>(
+                build_test_size));
+    }
+}
+BENCHMARK(dict_build_string_keys_without_hash_cache);
+
+static void string_dict_build_string_keys(benchmark::State& state) {
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(
+            build_string_map<io::string_dict<std::size_t>>(build_test_size));
+    }
+}
+BENCHMARK(string_dict_build_string_keys);
+
 static void umap_build_string_keys(benchmark::State& state) {
     for (auto __attribute__((unused)) _ : state) {
         benchmark::DoNotOptimize(
@@ -697,6 +1396,59 @@ static void dict_string_lookup(benchmark::State& state) {
 }
 BENCHMARK(dict_string_lookup);
 
+static void dict_string_lookup_without_hash_cache(benchmark::State& state) {
+    auto d = build_string_map<io::dict<std::string, std::size_t, uncached_string_hash>>(
+        string_lookup_test_size);
+    std::vector<std::string> keys{ "1111111", "2222222", "3333333",
+                                   "4444444", "5555555", "6666666",
+                                   "7777777", "8888888", "9999999" };
+
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(string_lookup_test(d, keys));
+    }
+}
+BENCHMARK(dict_string_lookup_without_hash_cache);
+
+static void string_dict_string_lookup(benchmark::State& state) {
+    auto d = build_string_map<io::string_dict<std::size_t>>(
+        string_lookup_test_size);
+    std::vector<std::string> keys{ "1111111", "2222222", "3333333",
+                                   "4444444", "5555555", "6666666",
+                                   "7777777", "8888888", "9999999" };
+
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(string_lookup_test(d, keys));
+    }
+}
+BENCHMARK(string_dict_string_lookup);
+
+// every key of the map, most are too long to be stored inline
+template <typename Map>
+void all_string_keys_lookup_test(benchmark::State& state) {
+    auto d = build_string_map<Map>(string_lookup_test_size);
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i != string_lookup_test_size; ++i) {
+        keys.push_back(std::to_string(i) + std::to_string(i) +
+                       std::to_string(i) + std::to_string(i) +
+                       std::to_string(i) + std::to_string(i) +
+                       std::to_string(i));
+    }
+
+    for (auto __attribute__((unused)) _ : state) {
+        benchmark::DoNotOptimize(string_lookup_test(d, keys));
+    }
+}
+
+static void dict_all_string_keys_lookup(benchmark::State& state) {
+    all_string_keys_lookup_test<io::dict<std::string, std::size_t>>(state);
+}
+BENCHMARK(dict_all_string_keys_lookup);
+
+static void string_dict_all_string_keys_lookup(benchmark::State& state) {
+    all_string_keys_lookup_test<io::string_dict<std::size_t>>(state);
+}
+BENCHMARK(string_dict_all_string_keys_lookup);
+
 static void umap_string_lookup(benchmark::State& state) {
     auto d = build_string_map<std::unordered_map<std::string, std::size_t>>(
         string_lookup_test_size);
@@ -738,6 +1490,137 @@ static void goog_string_lookup(benchmark::State& state) {
 BENCHMARK(goog_string_lookup);
 #endif
 
+constexpr std::size_t concurrent_test_size = 1 << 20;
+
+// every thread runs 90% lookups and 10% assignments on random keys
+template <typename Find, typename Assign>
+void concurrent_test(benchmark::State& state, Find find, Assign assign) {
+    std::uniform_int_distribution<std::size_t> keys(0,
+                                                    concurrent_test_size - 1);
+    std::mt19937 engine(
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    std::size_t res = 0;
+    for (auto __attribute__((unused)) _ : state) {
+        for (int i = 0; i != 100; ++i) {
+            auto key = keys(engine);
+            if (i % 10) {
+                res += find(key);
+            } else {
+                assign(key, i);
+            }
+        }
+    }
+    benchmark::DoNotOptimize(res);
+}
+
+static void concurrent_dict_mixed(benchmark::State& state) {
+    static io::concurrent_dict<std::size_t, std::size_t> d;
+    static std::once_flag built;
+    std::call_once(built, [] {
+        for (std::size_t i = 0; i != concurrent_test_size; ++i) {
+            d.insert_or_assign(i, i);
+        }
+    });
+
+    concurrent_test(state,
+                    [](std::size_t key) {
+                        std::size_t value = 0;
+                        d.find(key, value);
+                        return value;
+                    },
+                    [](std::size_t key, std::size_t value) {
+                        d.insert_or_assign(key, value);
+                    });
+}
+BENCHMARK(concurrent_dict_mixed)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
+// the whole dict behind a single lock for comparison
+static void locked_dict_mixed(benchmark::State& state) {
+    static io::dict<std::size_t, std::size_t> d;
+    static std::mutex mutex;
+    static std::once_flag built;
+    std::call_once(built, [] {
+        for (std::size_t i = 0; i != concurrent_test_size; ++i) {
+            d[i] = i;
+        }
+    });
+
+    concurrent_test(state,
+                    [](std::size_t key) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        auto iter = d.find(key);
+                        return iter != d.end() ? iter->second : 0;
+                    },
+                    [](std::size_t key, std::size_t value) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        d[key] = value;
+                    });
+}
+BENCHMARK(locked_dict_mixed)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
+// lookups only, to show how reads scale with the number of threads
+template <typename Find>
+void concurrent_read_test(benchmark::State& state, Find find) {
+    std::uniform_int_distribution<std::size_t> keys(0,
+                                                    concurrent_test_size - 1);
+    std::mt19937 engine(
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    std::size_t res = 0;
+    for (auto __attribute__((unused)) _ : state) {
+        for (int i = 0; i != 100; ++i) {
+            res += find(keys(engine));
+        }
+    }
+    benchmark::DoNotOptimize(res);
+}
+
+static void read_mostly_dict_lookup(benchmark::State& state) {
+    static io::read_mostly_dict<std::size_t, std::size_t> d;
+    static std::once_flag built;
+    std::call_once(built, [] {
+        io::read_mostly_dict<std::size_t, std::size_t>::batch changes;
+        for (std::size_t i = 0; i != concurrent_test_size; ++i) {
+            changes.insert_or_assign(i, i);
+        }
+        d.apply(changes);
+    });
+
+    auto reader = d.make_reader();
+    concurrent_read_test(state, [&](std::size_t key) {
+        std::size_t value = 0;
+        reader.find(key, value);
+        return value;
+    });
+}
+BENCHMARK(read_mostly_dict_lookup)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
+static void concurrent_dict_lookup(benchmark::State& state) {
+    static io::concurrent_dict<std::size_t, std::size_t> d;
+    static std::once_flag built;
+    std::call_once(built, [] {
+        for (std::size_t i = 0; i != concurrent_test_size; ++i) {
+            d.insert_or_assign(i, i);
+        }
+    });
+
+    concurrent_read_test(state, [](std::size_t key) {
+        std::size_t value = 0;
+        d.find(key, value);
+        return value;
+    });
+}
+BENCHMARK(concurrent_dict_lookup)
+    ->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))
+    ->UseRealTime();
+
 int main(int argc, char** argv) {
     benchmark::Initialize(&argc, argv);
     benchmark::RunSpecifiedBenchmarks();
@@ -1,13 +1,34 @@
 #include "catch/single_include/catch.hpp"
 
+#include "../include/dict/concurrent_dict.hpp"
+#include "../include/dict/read_mostly_dict.hpp"
 #include "../include/dict/dict.hpp"
-
+#include "../include/dict/frozen_dict.hpp"
+#include "../include/dict/huge_page_allocator.hpp"
+#include "../include/dict/mapped_dict.hpp"
+#include "../include/dict/node_dict.hpp"
+#include "../include/dict/recycling_resource.hpp"
+#include "../include/dict/small_dict.hpp"
+#include "../include/dict/static_dict.hpp"
+#include "../include/dict/string_dict.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <unordered_map>
 #include <vector>
 #include <string>
 #include <future>
 #include <numeric>
+#include <set>
 #include <memory>
+#include <random>
 
 struct fake_hasher {
     std::size_t operator()(int) const { return 42; }
@@ -485,6 +506,36 @@ TEST_CASE("dict swap", "[dict][swap]") {
         CHECK(d[0] == 0);
         CHECK(empty_dict[0] == 42);
     }
+    SECTION("iterators follow their elements") {
+        io::dict<int, int> a{ { 1, 10 }, { 2, 20 } };
+        io::dict<int, int> b{ { 3, 30 } };
+
+        auto it = a.find(1);
+        a.swap(b);
+
+        CHECK(it->first == 1);
+        CHECK(it->second == 10);
+        CHECK(b.find(1) == it);
+        CHECK(a.find(1) == a.end());
+
+        io::dict<int, int> moved(std::move(b));
+        CHECK(moved.find(1) == it);
+        CHECK(std::distance(it, moved.end()) >= 1);
+    }
+    SECTION("node storage iterators follow their elements") {
+        using node_dict = io::dict<int, int, std::hash<int>,
+                                   std::equal_to<int>,
+                                   std::allocator<std::pair<const int, int>>,
+                                   io::node_storage>;
+        node_dict a{ { 1, 10 } };
+        node_dict b;
+
+        auto it = a.find(1);
+        a.swap(b);
+
+        CHECK(it->second == 10);
+        CHECK(b.find(1) == it);
+    }
 }
 
 TEST_CASE("dict find", "[dict][find]") {
@@ -630,6 +681,45 @@ TEST_CASE("dict reserve", "[dict][reserve]") {
     CHECK_FALSE(d.next_is_rehash());
 }
 
+TEST_CASE("dict reserve below size", "[dict][reserve]") {
+    io::dict<int, int> d(8);
+    d[0] = 0;
+    auto load = d.load_factor();
+
+    // more elements than fit below the load factor but fewer than slots
+    d.reserve(std::size_t(d.max_load_factor() / load) + 1);
+    CHECK(d.load_factor() < load);
+}
+
+TEST_CASE("dict range construction", "[dict][construct]") {
+    std::vector<std::pair<int, int>> elements;
+    for (int i = 0; i != 1000; ++i) {
+        elements.emplace_back(i % 700, i);
+    }
+
+    SECTION("first of equal keys wins") {
+        io::dict<int, int> d(elements.begin(), elements.end());
+        CHECK(d.size() == 700);
+        CHECK(d[5] == 5);
+        CHECK(d[699] == 699);
+    }
+
+    SECTION("size hint") {
+        io::dict<int, int> d(elements.begin(), elements.end(), 100000);
+        CHECK(d.size() == 700);
+        CHECK(d.load_factor() < 0.01f);
+    }
+
+    SECTION("insert range") {
+        io::dict<int, int> d{ { 1, -1 } };
+        d.insert(elements.begin(), elements.end());
+        CHECK(d.size() == 700);
+        CHECK(d[1] == -1);
+        CHECK(d[2] == 2);
+        CHECK_FALSE(d.next_is_rehash());
+    }
+}
+
 TEST_CASE("dict insert 1000", "[dict][stress]") {
     io::dict<int, int> d;
     CHECK(d.size() == 0);
@@ -666,6 +756,43 @@ TEST_CASE("dict clear", "[dict][clear]") {
         CHECK(d.size() == 1);
         CHECK(d[1] == 42);
     }
+
+    SECTION("clear keeps the table") {
+        io::dict<int, destructor_check> d(1 << 12);
+        auto ptr = std::make_shared<bool>(false);
+        d[7] = destructor_check(ptr);
+        auto max_load_factor = d.max_load_factor();
+
+        // the entry lets go of its shared_ptr
+        d.clear();
+        CHECK(ptr.use_count() == 1);
+        CHECK(d.begin() == d.end());
+
+        d[7];
+        CHECK(d.load_factor() < 0.001f);
+        CHECK(d.max_load_factor() == max_load_factor);
+    }
+
+    SECTION("clear_and_shrink") {
+        io::dict<int, int> d(1 << 12);
+        d.max_load_factor(0.5);
+        for (int i = 0; i != 1000; ++i) {
+            d[i] = i;
+        }
+
+        d.clear_and_shrink();
+        CHECK(d.size() == 0);
+        CHECK(d.find(1) == d.end());
+
+        d[1] = 1;
+        CHECK(d.load_factor() > 0.01f);
+        CHECK(d.max_load_factor() == Approx(0.5f).epsilon(0.1));
+
+        d.clear_and_shrink(1000);
+        CHECK(d.empty());
+        d[1] = 1;
+        CHECK(d.load_factor() < 0.001f);
+    }
 }
 
 TEST_CASE("dict iteration", "[dict][iter]") {
@@ -831,61 +958,2085 @@ TEST_CASE("hash mixer", "[dict]") {
     }
 }
 
-#ifdef __cpp_deduction_guides
-TEST_CASE("C++17 deduction guides", "[dict][C++17]") {
-    io::dict<int, int> d_with_types{{1,2}, {3,4}};
-    io::dict d_without_types(d_with_types.begin(), d_with_types.end());
+template <typename Key, typename Value, typename Storage,
+          typename Hasher = std::hash<Key>>
+using storage_dict =
+    io::dict<Key, Value, Hasher, std::equal_to<Key>,
+             std::allocator<std::pair<const Key, Value>>, Storage>;
+
+// runs a random mix of inserts, erases and lookups against unordered_map
+template <typename Dict>
+void check_against_unordered_map(Dict& d, int key_range) {
+    std::unordered_map<int, int> reference;
+    std::mt19937 engine;
+    std::uniform_int_distribution<int> keys(0, key_range);
+
+    int mismatches = 0;
+    for (int i = 0; i != 20000; ++i) {
+        auto key = keys(engine);
+        switch (i % 3) {
+        case 0:
+            d[key] = i;
+            reference[key] = i;
+            break;
+        case 1:
+            mismatches += d.erase(key) != reference.erase(key);
+            break;
+        default:
+            mismatches += d.count(key) != reference.count(key);
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(d.size() == reference.size());
 
-    CHECK(d_without_types[1] == 2);
-    CHECK(d_without_types[3] == 4);
+    std::size_t iterated = 0;
+    for (auto&& e : d) {
+        ++iterated;
+        mismatches += reference.count(e.first) == 0 ||
+                      reference.at(e.first) != e.second;
+    }
+    CHECK(mismatches == 0);
+    CHECK(iterated == reference.size());
 }
-#endif
 
-TEST_CASE("nothrow move constructalbe", "[dict][construct]") {
-    // default ctors
-    static_assert(std::is_default_constructible<io::dict<int, std::string>>::value,
-        "dict should be default constructible");
-    // Need to make dict() not allocate for that
-    // static_assert(std::is_nothrow_default_constructible<io::dict<int, std::string>>::value,
-    //     "dict should be noexcept default constructible");
+TEST_CASE("control byte storage", "[dict][storage]") {
+    SECTION("against unordered_map") {
+        storage_dict<int, int, io::control_byte_storage> d;
+        check_against_unordered_map(d, 2000);
+    }
 
-    // copy ctors
-    static_assert(std::is_copy_constructible<io::dict<int, std::string>>::value,
-        "dict should be copy constructible");
+    SECTION("against unordered_map with mixed hash") {
+        storage_dict<int, int, io::control_byte_storage,
+                     io::murmur_hash_mixer<std::hash<int>>> d;
+        check_against_unordered_map(d, 2000);
+    }
 
-    // move ctors
-    static_assert(std::is_move_constructible<io::dict<int, std::string>>::value,
-        "dict should be move constructible");
-    static_assert(std::is_nothrow_move_constructible<io::dict<int, std::string>>::value,
-        "dict should be noexcept move constructible");
+    SECTION("against unordered_map with collisions") {
+        storage_dict<int, int, io::control_byte_storage, fake_hasher> d;
+        check_against_unordered_map(d, 100);
+    }
 
-    // copy assignment
-    static_assert(std::is_copy_assignable<io::dict<int, std::string>>::value,
-        "dict should be copy assignable");
+    SECTION("table smaller than a group") {
+        storage_dict<int, int, io::control_byte_storage, big_hash> d(1);
+        d[1] = 1;
+        d[2] = 2;
+        d[3] = 3;
 
-    // move assignment
-    static_assert(std::is_move_assignable<io::dict<int, std::string>>::value,
-        "dict should be move assignable");
-    static_assert(std::is_nothrow_move_assignable<io::dict<int, std::string>>::value,
-        "dict should be noexcept move assignable");
+        CHECK(d.size() == 3);
+        CHECK(d.at(1) == 1);
+        CHECK(d.at(2) == 2);
+        CHECK(d.at(3) == 3);
+        CHECK(d.count(4) == 0);
+    }
 
-#ifdef __cpp_lib_is_swappable
-    // swapability
-    static_assert(std::is_swappable<io::dict<int, std::string>>::value,
-        "dict should be swappable");
-    // need to figure this out
-    // static_assert(std::is_nothrow_swappable<io::dict<int, std::string>>::value,
-    //     "dict should be noexcept swappable");
-#endif
+    SECTION("erase reshift") {
+        storage_dict<int, int, io::control_byte_storage, erase_move_hasher> d;
+
+        d[1] = 1;
+        d[2] = 2;
+        d[3] = 3;
+
+        CHECK(d.erase(d.find(1))->second == 3);
+        CHECK(d.size() == 2);
+        CHECK(d.find(1) == d.end());
+        CHECK(d.at(3) == 3);
+    }
+
+    SECTION("string values") {
+        storage_dict<int, std::string, io::control_byte_storage> d;
+        for (int i = 0; i != 100; ++i) {
+            d[i] = std::to_string(i);
+        }
+
+        for (int i = 0; i != 100; i += 2) {
+            d.erase(i);
+        }
+
+        CHECK(d.size() == 50);
+        CHECK(d.at(51) == "51");
+        CHECK(d.count(50) == 0);
+    }
 }
 
-#if __cpp_lib_memory_resource
-TEST_CASE("pmr support", "[dict][pmr]") {
-    auto allocator = std::experimental::pmr::new_delete_resource();
-    io::pmr::dict<int, int> pmr_dict(allocator);
+TEST_CASE("bitmap storage", "[dict][storage]") {
+    SECTION("against unordered_map") {
+        storage_dict<int, int, io::bitmap_storage> d;
+        check_against_unordered_map(d, 2000);
+    }
 
-    pmr_dict[1] = 2;
+    SECTION("against unordered_map with collisions") {
+        storage_dict<int, int, io::bitmap_storage, fake_hasher> d;
+        check_against_unordered_map(d, 100);
+    }
 
-    CHECK(pmr_dict[1] == 2);
+    SECTION("no per entry overhead") {
+        static_assert(
+            sizeof(io::detail::dict_entry<std::uint64_t, std::uint64_t>) ==
+                sizeof(std::pair<std::uint64_t, std::uint64_t>),
+            "entries should not carry an occupancy flag");
+    }
+
+    SECTION("iteration skips empty words") {
+        storage_dict<int, int, io::bitmap_storage, identity_hasher> d(1000);
+        d[3] = 3;
+        d[200] = 200;
+        d[900] = 900;
+
+        std::vector<int> keys;
+        for (auto&& e : d) {
+            keys.push_back(e.first);
+        }
+
+        CHECK(keys == std::vector<int>({ 3, 200, 900 }));
+    }
+}
+
+using int_sentinel_storage =
+    io::sentinel_storage<io::empty_key<int, std::numeric_limits<int>::min()>>;
+
+TEST_CASE("sentinel storage", "[dict][storage]") {
+    SECTION("against unordered_map") {
+        storage_dict<int, int, int_sentinel_storage> d;
+        check_against_unordered_map(d, 2000);
+    }
+
+    SECTION("against unordered_map with collisions") {
+        storage_dict<int, int, int_sentinel_storage, fake_hasher> d;
+        check_against_unordered_map(d, 100);
+    }
+
+    SECTION("no per entry overhead") {
+        using table = int_sentinel_storage::table<
+            io::detail::dict_entry<int, int>, std::allocator<int>>;
+        table t(std::allocator<int>{});
+        t.resize(8);
+        std::size_t bytes = 0;
+        t.for_each_array([&](const void*, std::size_t size) { bytes += size; });
+        CHECK(bytes == 8 * sizeof(std::pair<int, int>));
+    }
+
+    SECTION("the empty key can't be inserted") {
+        storage_dict<int, std::string, int_sentinel_storage> d;
+        auto empty = std::numeric_limits<int>::min();
+        CHECK_THROWS_AS(d[empty], std::invalid_argument);
+        CHECK_THROWS_AS(d.emplace(empty, "x"), std::invalid_argument);
+        CHECK(d.empty());
+        CHECK(d.find(empty) == d.end());
+        CHECK(d.erase(empty) == 0);
+    }
+
+    SECTION("clear and reuse") {
+        storage_dict<int, std::string, int_sentinel_storage> d;
+        for (int i = 0; i != 100; ++i) {
+            d[i] = std::to_string(i);
+        }
+        auto copy = d;
+        d.clear();
+        CHECK(d.empty());
+        CHECK(d.begin() == d.end());
+        CHECK(d.find(5) == d.end());
+        d[5] = "5";
+        CHECK(d.size() == 1);
+        CHECK(copy.size() == 100);
+        CHECK(copy.at(99) == "99");
+    }
+
+    SECTION("pointer keys") {
+        int values[4] = {};
+        storage_dict<const int*, int,
+                     io::sentinel_storage<io::empty_key<const int*, nullptr>>>
+            d;
+        for (int i = 0; i != 4; ++i) {
+            d[&values[i]] = i;
+        }
+        CHECK(d.at(&values[2]) == 2);
+        CHECK(d.count(nullptr) == 0);
+        CHECK(d.erase(&values[1]) == 1);
+        CHECK(d.size() == 3);
+    }
+}
+
+struct counting_equal {
+    bool operator()(int lhs, int rhs) const {
+        ++*count;
+        return lhs == rhs;
+    }
+
+    int* count;
+};
+
+TEST_CASE("robin hood storage", "[dict][storage]") {
+    SECTION("against unordered_map") {
+        storage_dict<int, int, io::robin_hood_storage> d;
+        check_against_unordered_map(d, 2000);
+    }
+
+    SECTION("against unordered_map with mixed hash") {
+        storage_dict<int, int, io::robin_hood_storage,
+                     io::murmur_hash_mixer<std::hash<int>>> d;
+        check_against_unordered_map(d, 2000);
+    }
+
+    SECTION("against unordered_map with collisions") {
+        storage_dict<int, int, io::robin_hood_storage, fake_hasher> d;
+        check_against_unordered_map(d, 100);
+    }
+
+    SECTION("insert displaces entries closer to home") {
+        storage_dict<int, int, io::robin_hood_storage, identity_hasher> d;
+        d[1] = 1;
+        d[2] = 2;
+        d[17] = 17;
+
+        std::vector<int> keys;
+        for (auto&& e : d) {
+            keys.push_back(e.first);
+        }
+
+        // 17 shares the home of 1 and takes the slot of 2
+        CHECK(keys == std::vector<int>({ 1, 17, 2 }));
+        CHECK(d.at(2) == 2);
+        CHECK(d.at(17) == 17);
+    }
+
+    SECTION("misses stop early") {
+        int compares = 0;
+        io::dict<int, int, identity_hasher, counting_equal,
+                 std::allocator<std::pair<const int, int>>,
+                 io::robin_hood_storage>
+            d(10, identity_hasher(), counting_equal{ &compares });
+
+        for (int i = 0; i != 10; ++i) {
+            d[i] = i;
+        }
+
+        compares = 0;
+        CHECK(d.find(16) == d.end());
+        CHECK(compares == 1);
+    }
+
+    SECTION("erase shifts back") {
+        storage_dict<int, int, io::robin_hood_storage, erase_move_hasher> d;
+
+        d[1] = 1;
+        d[2] = 2;
+        d[3] = 3;
+
+        CHECK(d.erase(1) == 1);
+        CHECK(d.size() == 2);
+        CHECK(d.find(1) == d.end());
+        CHECK(d.at(2) == 2);
+        CHECK(d.at(3) == 3);
+    }
+}
+
+TEST_CASE("node storage", "[dict][storage]") {
+    SECTION("against unordered_map") {
+        io::node_dict<int, int> d;
+        check_against_unordered_map(d, 2000);
+    }
+
+    SECTION("against unordered_map with collisions") {
+        storage_dict<int, int, io::node_storage, fake_hasher> d;
+        check_against_unordered_map(d, 100);
+    }
+
+    SECTION("references survive rehashing and erase") {
+        io::node_dict<int, std::string, io::murmur_hash_mixer<std::hash<int>>>
+            d;
+        d.rehash_step(1);
+        std::vector<const std::string*> values;
+        for (int i = 0; i != 3000; ++i) {
+            values.push_back(&(d[i] = std::to_string(i)));
+        }
+        CHECK(d.rehashing());
+
+        d.reserve(1 << 14);
+        d.reserve(1 << 17, 4);
+        for (int i = 0; i < 3000; i += 2) {
+            d.erase(i);
+        }
+
+        int moved = 0;
+        for (int i = 1; i < 3000; i += 2) {
+            moved += &d.at(i) != values[i] || *values[i] != std::to_string(i);
+        }
+        CHECK(moved == 0);
+    }
+
+    // the old and the new table of the copy have pools of their own, so
+    // finishing the rehash moves the elements instead of their nodes
+    SECTION("copy while rehashing") {
+        io::node_dict<int, std::string> d;
+        d.rehash_step(1);
+        for (int i = 0; i != 3000; ++i) {
+            d[i] = std::to_string(i);
+        }
+        REQUIRE(d.rehashing());
+
+        auto copy = d;
+        CHECK(copy.get_allocator() != d.get_allocator());
+        d.clear();
+        for (int i = 3000; i != 3100; ++i) {
+            copy[i] = std::to_string(i);
+        }
+        copy.rehash_step(0);
+        CHECK(!copy.rehashing());
+
+        int mismatches = 0;
+        for (int i = 0; i != 3100; ++i) {
+            mismatches += copy.at(i) != std::to_string(i);
+        }
+        CHECK(mismatches == 0);
+    }
+
+    SECTION("erased nodes are reused") {
+        io::node_dict<int, int> d;
+        auto node = &d[1];
+        d.erase(1);
+        CHECK(&d[2] == node);
+    }
+}
+
+TEST_CASE("pool allocator", "[pool_allocator]") {
+    io::pool_allocator<int> alloc;
+    io::pool_allocator<double> rebound(alloc);
+    CHECK(rebound == alloc);
+    CHECK(io::pool_allocator<int>() != alloc);
+
+    // blocks of one size come from one slab
+    auto first = rebound.allocate(1);
+    auto second = rebound.allocate(1);
+    CHECK(second == first + 1);
+    rebound.deallocate(first, 1);
+    CHECK(rebound.allocate(1) == first);
+
+    auto array = alloc.allocate(100);
+    array[99] = 1;
+    alloc.deallocate(array, 100);
+    rebound.deallocate(first, 1);
+    rebound.deallocate(second, 1);
+
+    std::vector<int, io::pool_allocator<int>> v(alloc);
+    v.assign(1000, 1);
+    CHECK(std::accumulate(v.begin(), v.end(), 0) == 1000);
+}
+
+TEST_CASE("huge page allocator", "[huge_page_allocator]") {
+    io::huge_page_allocator<std::size_t> alloc;
+    io::huge_page_allocator<char> rebound(alloc);
+    CHECK(rebound == alloc);
+
+    auto small = alloc.allocate(100);
+    small[99] = 1;
+    alloc.deallocate(small, 100);
+
+    // large arrays start at a huge page and are writable to the end
+    const auto count = 3 * io::huge_page_allocator<std::size_t>::min_bytes() /
+                       sizeof(std::size_t);
+    auto large = alloc.allocate(count);
+    CHECK(reinterpret_cast<std::uintptr_t>(large) %
+              io::huge_page_allocator<std::size_t>::min_bytes() == 0);
+    large[0] = 1;
+    large[count - 1] = 2;
+    alloc.deallocate(large, count);
+
+    io::dict<std::size_t, std::size_t, std::hash<std::size_t>,
+             std::equal_to<std::size_t>,
+             io::huge_page_allocator<std::pair<const std::size_t, std::size_t>>>
+        d;
+    for (std::size_t i = 0; i != 1 << 18; ++i) {
+        d[i] = i;
+    }
+    CHECK(d.size() == 1 << 18);
+    CHECK(d.at(12345) == 12345);
+
+    auto copy = d;
+    CHECK(copy == d);
+
+    d.clear_and_shrink();
+    CHECK(d.empty());
+    CHECK(copy.at(4321) == 4321);
+}
+
+// the numbers every storage has to agree on after 1000 inserts
+template <typename Dict>
+void check_stats() {
+    Dict d;
+    CHECK(d.stats().rehashes == 0);
+    CHECK(d.stats().longest_cluster == 0);
+    CHECK(d.stats().average_miss_probe == 1);
+
+    for (int i = 0; i != 1000; ++i) {
+        d[i * 7] = i;
+    }
+
+    auto stats = d.stats();
+    CHECK(std::accumulate(stats.displacements.begin(),
+                          stats.displacements.end(), std::size_t(0)) == 1000);
+    CHECK(stats.max_hit_probe == stats.displacements.size());
+    CHECK(stats.average_hit_probe >= 1);
+    CHECK(stats.longest_cluster >= stats.max_hit_probe);
+    CHECK(stats.max_miss_probe == stats.longest_cluster + 1);
+    CHECK(stats.payload_bytes == 1000 * sizeof(typename Dict::value_type));
+    CHECK(stats.allocated_bytes > stats.payload_bytes);
+    CHECK(stats.rehashes > 0);
+}
+
+TEST_CASE("stats", "[dict][stats]") {
+    SECTION("probes and clusters") {
+        io::dict<int, int, identity_hasher> d;
+        d[0] = 0;
+        const int slots = std::lround(1 / d.load_factor());
+
+        // three keys in a row from slot 0 and one on its own
+        d[slots] = 1;
+        d[2 * slots] = 2;
+        d[5] = 3;
+
+        auto stats = d.stats();
+        CHECK(stats.displacements == std::vector<std::size_t>{ 2, 1, 1 });
+        CHECK(stats.average_hit_probe == 7 / 4.);
+        CHECK(stats.max_hit_probe == 3);
+        CHECK(stats.longest_cluster == 3);
+        CHECK(stats.max_miss_probe == 4);
+        // 4 + 3 + 2 for the cluster, 2 + 1 for the single key and 1 for
+        // every other free slot
+        CHECK(stats.average_miss_probe == double(slots + 7) / slots);
+        CHECK(stats.rehashes == 0);
+    }
+
+    SECTION("storages") {
+        check_stats<io::dict<int, int>>();
+        check_stats<storage_dict<int, int, io::control_byte_storage>>();
+        check_stats<storage_dict<int, int, io::bitmap_storage>>();
+        check_stats<storage_dict<int, int, io::robin_hood_storage>>();
+        check_stats<storage_dict<int, int, io::node_storage>>();
+        check_stats<storage_dict<int, int, int_sentinel_storage>>();
+    }
+
+    SECTION("rehashes") {
+        io::dict<int, int> d;
+        d.reserve(1000);
+        CHECK(d.stats().rehashes == 1);
+
+        // an incremental rehash counts when it starts
+        d.rehash_step(1);
+        int i = 0;
+        while (!d.rehashing()) {
+            d[i] = i;
+            ++i;
+        }
+        CHECK(d.stats().rehashes == 2);
+        CHECK(d.stats().allocated_bytes > d.stats().payload_bytes);
+
+        d.clear_and_shrink();
+        CHECK(d.stats().rehashes == 2);
+    }
+}
+
+TEST_CASE("inline flag storage against unordered_map", "[dict][storage]") {
+    io::dict<int, int> d;
+    check_against_unordered_map(d, 2000);
+}
+
+struct counting_hasher {
+    std::size_t operator()(int x) const {
+        ++*count;
+        return x;
+    }
+
+    int* count;
+};
+
+namespace io {
+template <>
+struct cache_hash<int, counting_hasher> : std::true_type {};
+} // namespace io
+
+TEST_CASE("cached hash", "[dict][cache_hash]") {
+    static_assert(io::cache_hash<std::string, std::hash<std::string>>::value,
+                  "string keys should cache their hash by default");
+    static_assert(!io::cache_hash<int, std::hash<int>>::value,
+                  "int keys should not cache their hash by default");
+    static_assert(!io::cache_hash<std::pair<int, int>, fake_hasher>::value,
+                  "only string keys should cache their hash by default");
+
+    SECTION("rehash doesn't call the hasher") {
+        int hashes = 0;
+        io::dict<int, int, counting_hasher> d(16, counting_hasher{ &hashes });
+
+        for (int i = 0; i != 100; ++i) {
+            d[i] = i;
+        }
+
+        hashes = 0;
+        d.reserve(10000);
+        CHECK(hashes == 0);
+
+        for (int i = 0; i != 100; ++i) {
+            CHECK(d.at(i) == i);
+        }
+    }
+
+    SECTION("erase shift doesn't call the hasher") {
+        int hashes = 0;
+        io::dict<int, int, counting_hasher> d(16, counting_hasher{ &hashes });
+
+        // one cluster with shared homes
+        d[1] = 1;
+        d[17] = 17;
+        d[33] = 33;
+        d[2] = 2;
+
+        hashes = 0;
+        CHECK(d.erase(1) == 1);
+        CHECK(hashes == 1);
+        CHECK(d.at(17) == 17);
+        CHECK(d.at(33) == 33);
+        CHECK(d.at(2) == 2);
+    }
+
+    SECTION("string keys") {
+        io::dict<std::string, int> d;
+        for (int i = 0; i != 1000; ++i) {
+            d[std::to_string(i)] = i;
+        }
+
+        for (int i = 0; i != 1000; i += 2) {
+            d.erase(std::to_string(i));
+        }
+
+        CHECK(d.size() == 500);
+        CHECK(d.at("999") == 999);
+        CHECK(d.count("998") == 0);
+    }
+}
+
+// counts how many keys are materialised
+struct tracked_key {
+    tracked_key() = default;
+    explicit tracked_key(const char* str) : value(str) { ++constructions; }
+    tracked_key(const tracked_key& other) : value(other.value) {
+        ++constructions;
+    }
+    tracked_key(tracked_key&&) = default;
+    tracked_key& operator=(const tracked_key&) = default;
+    tracked_key& operator=(tracked_key&&) = default;
+
+    std::string value;
+
+    static int constructions;
+};
+
+int tracked_key::constructions = 0;
+
+struct tracked_key_hash {
+    using is_transparent = void;
+
+    std::size_t operator()(const tracked_key& key) const {
+        return (*this)(key.value.c_str());
+    }
+
+    std::size_t operator()(const char* str) const {
+        std::size_t hash = 0;
+        for (; *str; ++str) {
+            hash = hash * 31 + *str;
+        }
+        return hash;
+    }
+};
+
+struct tracked_key_equal {
+    using is_transparent = void;
+
+    bool operator()(const tracked_key& lhs, const tracked_key& rhs) const {
+        return lhs.value == rhs.value;
+    }
+
+    bool operator()(const tracked_key& lhs, const char* rhs) const {
+        return lhs.value == rhs;
+    }
+};
+
+TEST_CASE("transparent lookup", "[dict][transparent]") {
+    io::dict<tracked_key, int, tracked_key_hash, tracked_key_equal> d;
+    d[tracked_key("one")] = 1;
+    d[tracked_key("two")] = 2;
+
+    tracked_key::constructions = 0;
+
+    SECTION("find") {
+        CHECK(d.find("one")->second == 1);
+        CHECK(d.find("three") == d.end());
+
+        const auto& const_d = d;
+        CHECK(const_d.find("two")->second == 2);
+        CHECK(tracked_key::constructions == 0);
+    }
+
+    SECTION("at and count") {
+        CHECK(d.at("one") == 1);
+        CHECK_THROWS_AS(d.at("three"), std::out_of_range);
+        CHECK(d.count("two") == 1);
+        CHECK(d.count("three") == 0);
+        CHECK(d.equal_range("one").first->second == 1);
+        CHECK(tracked_key::constructions == 0);
+    }
+
+    SECTION("erase") {
+        CHECK(d.erase("one") == 1);
+        CHECK(d.erase("one") == 0);
+        CHECK(d.size() == 1);
+        CHECK(tracked_key::constructions == 0);
+
+        // iterators still go to the iterator overload
+        CHECK(d.erase(d.find("two")) == d.end());
+        CHECK(d.empty());
+    }
+
+    SECTION("operator[]") {
+        d["one"] = 11;
+        CHECK(tracked_key::constructions == 0);
+
+        d["three"] = 3;
+        CHECK(tracked_key::constructions == 1);
+        CHECK(d.at("three") == 3);
+        CHECK(d.at("one") == 11);
+    }
+
+    SECTION("try_emplace") {
+        auto res_fail = d.try_emplace("one", 42);
+        CHECK(res_fail.second == false);
+        CHECK(res_fail.first->second == 1);
+        CHECK(tracked_key::constructions == 0);
+
+        auto res_success = d.try_emplace("three", 3);
+        CHECK(res_success.second == true);
+        CHECK(res_success.first->second == 3);
+        CHECK(tracked_key::constructions == 1);
+
+        auto res_hint = d.try_emplace(d.cend(), "four", 4);
+        CHECK(res_hint->second == 4);
+    }
+}
+
+template <typename Dict>
+void check_incremental_rehash() {
+    SECTION("against unordered_map") {
+        Dict d;
+        d.rehash_step(1);
+        check_against_unordered_map(d, 20000);
+    }
+
+    SECTION("lookup, iteration and erase while rehashing") {
+        Dict d;
+        d.rehash_step(1);
+
+        int count = 0;
+        while (!d.rehashing()) {
+            d[count] = count;
+            ++count;
+        }
+
+        // one more insert moves only part of the old table
+        d[count] = count;
+        ++count;
+        CHECK(d.rehashing());
+        CHECK(d.size() == std::size_t(count));
+
+        int mismatches = 0;
+        for (int i = 0; i != count; ++i) {
+            mismatches += d.at(i) != i;
+        }
+        CHECK(mismatches == 0);
+        CHECK(std::distance(d.begin(), d.end()) == count);
+        CHECK(std::distance(d.cbegin(), d.cend()) == count);
+
+        CHECK(d.erase(0) == 1);
+        CHECK(d.count(0) == 0);
+        CHECK(d.insert_or_assign(1, 11).second == false);
+        CHECK(d.at(1) == 11);
+
+        auto iter = d.begin();
+        while (iter != d.end()) {
+            iter = d.erase(iter);
+        }
+        CHECK(d.empty());
+    }
+
+    SECTION("finishing the rehash") {
+        Dict d;
+        d.rehash_step(1);
+
+        int count = 0;
+        while (!d.rehashing()) {
+            d[count] = count;
+            ++count;
+        }
+
+        d.rehash_step(0);
+        CHECK(!d.rehashing());
+        CHECK(d.size() == std::size_t(count));
+        CHECK(std::distance(d.begin(), d.end()) == count);
+    }
+}
+
+TEST_CASE("incremental rehash", "[dict][rehash]") {
+    SECTION("inline flag storage") {
+        check_incremental_rehash<io::dict<int, int>>();
+    }
+
+    SECTION("control byte storage") {
+        check_incremental_rehash<
+            storage_dict<int, int, io::control_byte_storage>>();
+    }
+
+    SECTION("bitmap storage") {
+        check_incremental_rehash<storage_dict<int, int, io::bitmap_storage>>();
+    }
+
+    SECTION("robin hood storage") {
+        check_incremental_rehash<
+            storage_dict<int, int, io::robin_hood_storage>>();
+    }
+
+    SECTION("node storage") {
+        check_incremental_rehash<io::node_dict<int, int>>();
+    }
+}
+
+template <typename Dict>
+void check_parallel_reserve() {
+    Dict d;
+    const int count = 50000;
+    for (int i = 0; i != count; ++i) {
+        d[i] = i;
+    }
+
+    d.reserve(1 << 19, 4);
+    CHECK(d.size() == std::size_t(count));
+    CHECK(d.load_factor() < 0.1f);
+    CHECK(std::distance(d.begin(), d.end()) == count);
+
+    int mismatches = 0;
+    for (int i = 0; i != count; ++i) {
+        mismatches += d.at(i) != i;
+    }
+    CHECK(mismatches == 0);
+
+    // the backward shift relies on every entry being reachable from its home
+    for (int i = 0; i < count; i += 2) {
+        mismatches += d.erase(i) != 1;
+    }
+    for (int i = 1; i < count; i += 2) {
+        mismatches += d.at(i) != i;
+    }
+    CHECK(mismatches == 0);
+    CHECK(d.size() == std::size_t(count / 2));
+}
+
+TEST_CASE("parallel reserve", "[dict][rehash]") {
+    using mixer = io::murmur_hash_mixer<std::hash<int>>;
+
+    SECTION("inline flag storage") {
+        check_parallel_reserve<io::dict<int, int, mixer>>();
+    }
+
+    SECTION("control byte storage") {
+        check_parallel_reserve<
+            storage_dict<int, int, io::control_byte_storage, mixer>>();
+    }
+
+    SECTION("bitmap storage") {
+        check_parallel_reserve<
+            storage_dict<int, int, io::bitmap_storage, mixer>>();
+    }
+
+    SECTION("robin hood storage") {
+        check_parallel_reserve<
+            storage_dict<int, int, io::robin_hood_storage, mixer>>();
+    }
+
+    SECTION("node storage") {
+        check_parallel_reserve<io::node_dict<int, int, mixer>>();
+    }
+}
+
+// four keys per home slot, so erasing has long clusters to compact
+struct clustering_hasher {
+    std::size_t operator()(int x) const {
+        return io::murmur_hash_mixer<std::hash<int>>()(x / 4);
+    }
+};
+
+template <typename Dict>
+void check_erase_if(std::size_t rehash_step) {
+    Dict d;
+    d.rehash_step(rehash_step);
+    std::map<int, int> reference;
+    // the table grew at 2868 elements, a rehash step of one slot per insert
+    // isn't done with the old table yet
+    for (int i = 0; i != 3000; ++i) {
+        d[i * 7 % 5003] = i;
+        reference[i * 7 % 5003] = i;
+    }
+    CHECK(d.rehashing() == (rehash_step != 0));
+
+    SECTION("erase_if") {
+        auto size = reference.size();
+        for (auto iter = reference.begin(); iter != reference.end();) {
+            if (iter->first % 3 == 0) {
+                iter = reference.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        CHECK(d.erase_if([](const std::pair<const int, int>& e) {
+            return e.first % 3 == 0;
+        }) == size - reference.size());
+
+        size = reference.size();
+        for (auto iter = reference.begin(); iter != reference.end();) {
+            if (iter->second % 5 == 0) {
+                iter = reference.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        CHECK(io::erase_if(d, [](std::pair<const int, int>& e) {
+            return e.second % 5 == 0;
+        }) == size - reference.size());
+    }
+
+    SECTION("erase range") {
+        auto first = std::next(d.begin(), 500);
+        auto last = std::next(first, 2000);
+        for (auto iter = first; iter != last; ++iter) {
+            reference.erase(iter->first);
+        }
+
+        d.erase(first, last);
+        CHECK(d.erase(d.cend(), d.cend()) == d.end());
+    }
+
+    SECTION("erase everything") {
+        CHECK(d.erase(d.cbegin(), d.cend()) == d.end());
+        reference.clear();
+    }
+
+    SECTION("throwing predicate") {
+        int calls = 0;
+        CHECK_THROWS_AS(d.erase_if([&](const std::pair<const int, int>& e) {
+            if (++calls == 2000) {
+                throw std::runtime_error("stop");
+            }
+            return e.first % 2 == 0;
+        }),
+                        std::runtime_error);
+
+        // whatever was erased before the throw, the rest can be found
+        for (auto iter = reference.begin(); iter != reference.end();) {
+            if (iter->first % 2 == 0 && !d.count(iter->first)) {
+                iter = reference.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    CHECK(d.size() == reference.size());
+    CHECK(std::size_t(std::distance(d.begin(), d.end())) == reference.size());
+
+    int mismatches = 0;
+    for (const auto& e : reference) {
+        auto iter = d.find(e.first);
+        mismatches += iter == d.end() || iter->second != e.second;
+    }
+    CHECK(mismatches == 0);
+
+    // the remaining entries still form proper clusters for the backward shift
+    for (const auto& e : reference) {
+        mismatches += d.erase(e.first) != 1;
+    }
+    CHECK(mismatches == 0);
+    CHECK(d.empty());
+}
+
+TEST_CASE("dict erase_if and range erase", "[dict][erase]") {
+    SECTION("inline flag storage") {
+        check_erase_if<io::dict<int, int, clustering_hasher>>(0);
+    }
+
+    SECTION("control byte storage") {
+        check_erase_if<storage_dict<int, int, io::control_byte_storage,
+                                    clustering_hasher>>(0);
+    }
+
+    SECTION("bitmap storage") {
+        check_erase_if<
+            storage_dict<int, int, io::bitmap_storage, clustering_hasher>>(0);
+    }
+
+    SECTION("robin hood storage") {
+        check_erase_if<storage_dict<int, int, io::robin_hood_storage,
+                                    clustering_hasher>>(0);
+    }
+
+    // half of the elements are still in the old table
+    SECTION("while rehashing") {
+        check_erase_if<io::dict<int, int, clustering_hasher>>(1);
+    }
+
+    SECTION("robin hood storage while rehashing") {
+        check_erase_if<storage_dict<int, int, io::robin_hood_storage,
+                                    clustering_hasher>>(1);
+    }
+
+    SECTION("node storage") {
+        check_erase_if<io::node_dict<int, int, clustering_hasher>>(0);
+    }
+
+    SECTION("node storage while rehashing") {
+        check_erase_if<io::node_dict<int, int, clustering_hasher>>(1);
+    }
+}
+
+template <typename Dict>
+void check_clear(bool rehashing) {
+    Dict d;
+    d.rehash_step(rehashing ? 1 : 0);
+    for (int i = 0; i != 3000; ++i) {
+        d[i] = std::to_string(i);
+    }
+    CHECK(d.rehashing() == rehashing);
+
+    d.clear();
+    CHECK(d.empty());
+    CHECK(!d.rehashing());
+    CHECK(d.begin() == d.end());
+
+    int mismatches = 0;
+    for (int i = 0; i != 3000; ++i) {
+        mismatches += d.count(i) != 0;
+    }
+    CHECK(mismatches == 0);
+
+    for (int i = 0; i != 100; ++i) {
+        d[i] = std::to_string(i);
+    }
+    CHECK(d.size() == 100);
+    CHECK(std::distance(d.begin(), d.end()) == 100);
+    CHECK(d.at(42) == "42");
+}
+
+TEST_CASE("dict clear storages", "[dict][clear]") {
+    for (bool rehashing : { false, true }) {
+        check_clear<io::dict<int, std::string>>(rehashing);
+        check_clear<storage_dict<int, std::string, io::control_byte_storage>>(
+            rehashing);
+        check_clear<storage_dict<int, std::string, io::bitmap_storage>>(
+            rehashing);
+        check_clear<storage_dict<int, std::string, io::robin_hood_storage>>(
+            rehashing);
+        check_clear<io::node_dict<int, std::string>>(rehashing);
+    }
+}
+
+// counts live instances, has no default constructor and can be told to
+// throw on a copy
+struct counted_value {
+    static int live;
+    static int copies_until_throw;
+
+    explicit counted_value(int value) : value(value) { ++live; }
+
+    counted_value(const counted_value& other) : value(other.value) {
+        if (copies_until_throw > 0 && --copies_until_throw == 0) {
+            throw std::runtime_error("copy");
+        }
+        ++live;
+    }
+
+    counted_value(counted_value&& other) noexcept : value(other.value) {
+        ++live;
+    }
+
+    counted_value& operator=(const counted_value&) = default;
+    counted_value& operator=(counted_value&&) = default;
+
+    ~counted_value() { --live; }
+
+    int value;
+};
+
+int counted_value::live = 0;
+int counted_value::copies_until_throw = 0;
+
+template <typename Dict>
+void check_raw_slots() {
+    {
+        Dict d(1 << 10);
+        CHECK(counted_value::live == 0);
+
+        for (int i = 0; i != 2000; ++i) {
+            d.emplace(std::piecewise_construct, std::forward_as_tuple(i),
+                      std::forward_as_tuple(i));
+        }
+        CHECK(counted_value::live == 2000);
+
+        for (int i = 0; i < 2000; i += 2) {
+            d.erase(i);
+        }
+        CHECK(counted_value::live == 1000);
+        CHECK(d.at(1).value == 1);
+
+        d.insert({ 1, counted_value(2) });
+        d.insert_or_assign(3, counted_value(4));
+        CHECK(d.at(1).value == 1);
+        CHECK(d.at(3).value == 4);
+
+        d.erase_if([](const std::pair<const int, counted_value>& e) {
+            return e.first % 4 == 1;
+        });
+        CHECK(counted_value::live == 500);
+
+        {
+            auto copy = d;
+            CHECK(counted_value::live == 1000);
+            CHECK(copy.at(3).value == 4);
+        }
+        CHECK(counted_value::live == 500);
+
+        // the entries copied before the throw are destroyed again
+        counted_value::copies_until_throw = 100;
+        CHECK_THROWS_AS(Dict(d), std::runtime_error);
+        counted_value::copies_until_throw = 0;
+        CHECK(counted_value::live == 500);
+
+        d.reserve(1 << 14);
+        CHECK(counted_value::live == 500);
+        CHECK(d.at(3).value == 4);
+
+        Dict moved(std::move(d));
+        d = moved;
+        CHECK(counted_value::live == 1000);
+
+        d.clear();
+        CHECK(counted_value::live == 500);
+    }
+    CHECK(counted_value::live == 0);
+}
+
+TEST_CASE("dict raw slots", "[dict][construct]") {
+    SECTION("inline flag storage") {
+        check_raw_slots<io::dict<int, counted_value>>();
+    }
+
+    SECTION("control byte storage") {
+        check_raw_slots<
+            storage_dict<int, counted_value, io::control_byte_storage>>();
+    }
+
+    SECTION("bitmap storage") {
+        check_raw_slots<storage_dict<int, counted_value, io::bitmap_storage>>();
+    }
+
+    SECTION("robin hood storage") {
+        check_raw_slots<
+            storage_dict<int, counted_value, io::robin_hood_storage>>();
+    }
+
+    SECTION("node storage") {
+        check_raw_slots<io::node_dict<int, counted_value>>();
+    }
+
+    SECTION("while rehashing") {
+        io::dict<int, counted_value> d;
+        d.rehash_step(1);
+        for (int i = 0; i != 100; ++i) {
+            d.emplace(i, counted_value(i));
+        }
+        CHECK(d.rehashing());
+        CHECK(counted_value::live == 100);
+
+        d.erase(50);
+        CHECK(counted_value::live == 99);
+        d.clear();
+        CHECK(counted_value::live == 0);
+    }
+}
+
+TEST_CASE("concurrent dict", "[concurrent_dict]") {
+    SECTION("single threaded") {
+        io::concurrent_dict<int, std::string> d(5);
+        CHECK(d.shard_count() == 8);
+        CHECK(d.empty());
+
+        CHECK(d.try_emplace(1, "one"));
+        CHECK(!d.try_emplace(1, "uno"));
+        CHECK(d.insert_or_assign(2, "two"));
+        CHECK(!d.insert_or_assign(2, "zwei"));
+        CHECK(d.size() == 2);
+        CHECK(d.contains(1));
+        CHECK(!d.contains(3));
+
+        std::string value;
+        CHECK(d.find(2, value));
+        CHECK(value == "zwei");
+        CHECK(!d.find(3, value));
+
+        CHECK(d.visit(1, [](std::pair<const int, std::string>& element) {
+            element.second += "!";
+        }));
+        CHECK(d.cvisit(1, [&](const std::pair<const int, std::string>& element) {
+            value = element.second;
+        }));
+        CHECK(value == "one!");
+
+        std::size_t visited = 0;
+        d.cvisit_all([&](const std::pair<const int, std::string>&) {
+            ++visited;
+        });
+        CHECK(visited == 2);
+
+        CHECK(d.erase(1) == 1);
+        CHECK(d.erase(1) == 0);
+        d.clear();
+        CHECK(d.empty());
+    }
+
+    SECTION("shards are cache aligned") {
+        struct alignas(64) aligned_shard {
+            char lock;
+        };
+
+        io::detail::cache_aligned_allocator<aligned_shard> alloc;
+        int misaligned = 0;
+        for (std::size_t n = 1; n != 100; ++n) {
+            std::vector<aligned_shard,
+                        io::detail::cache_aligned_allocator<aligned_shard>>
+                shards(n, aligned_shard(), alloc);
+            for (const auto& shard : shards) {
+                misaligned += reinterpret_cast<std::uintptr_t>(&shard) % 64 != 0;
+            }
+        }
+        CHECK(misaligned == 0);
+    }
+
+    SECTION("multi threaded") {
+        io::concurrent_dict<int, int> d(16);
+        d.try_emplace(-1, 0);
+
+        const int threads = 4;
+        const int per_thread = 5000;
+        std::vector<std::future<void>> workers;
+        for (int thread = 0; thread != threads; ++thread) {
+            workers.push_back(std::async(std::launch::async, [&d, thread] {
+                for (int i = 0; i != per_thread; ++i) {
+                    auto key = thread * per_thread + i;
+                    d.insert_or_assign(key, key);
+                    d.visit(-1, [](std::pair<const int, int>& counter) {
+                        ++counter.second;
+                    });
+                    if (i % 2) {
+                        d.erase(key);
+                    }
+                }
+            }));
+        }
+
+        for (auto& worker : workers) {
+            worker.get();
+        }
+
+        int counter = 0;
+        CHECK(d.find(-1, counter));
+        CHECK(counter == threads * per_thread);
+        CHECK(d.size() == std::size_t(threads * per_thread / 2 + 1));
+
+        int mismatches = 0;
+        for (int key = 0; key != threads * per_thread; ++key) {
+            mismatches += d.contains(key) != (key % 2 == 0);
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+struct no_default_value {
+    explicit no_default_value(int value) : value(value) {}
+
+    int value;
+};
+
+TEST_CASE("read mostly dict", "[read_mostly_dict]") {
+    SECTION("single threaded") {
+        io::read_mostly_dict<int, std::string> d;
+        auto reader = d.make_reader();
+        CHECK(!reader.contains(1));
+
+        d.insert_or_assign(1, "one");
+        io::read_mostly_dict<int, std::string>::batch changes;
+        changes.insert_or_assign(2, "two");
+        changes.insert_or_assign(3, "three");
+        changes.erase(1);
+        changes.insert_or_assign(2, "zwei");
+        d.apply(changes);
+
+        std::string value;
+        CHECK(!reader.find(1, value));
+        CHECK(reader.find(2, value));
+        CHECK(value == "zwei");
+        CHECK(reader.visit(3, [&](const std::pair<const int, std::string>&
+                                      element) { value = element.second; }));
+        CHECK(value == "three");
+
+        // both copies went through the same changes
+        d.erase(3);
+        CHECK(reader.read([](const io::dict<int, std::string>& copy) {
+            return copy.size();
+        }) == 1);
+        d.erase(2);
+        CHECK(reader.read([](const io::dict<int, std::string>& copy) {
+            return copy.empty();
+        }));
+
+        auto other = d.make_reader();
+        CHECK(!other.contains(2));
+    }
+
+    SECTION("values without a default constructor") {
+        io::read_mostly_dict<int, no_default_value> d;
+        io::read_mostly_dict<int, no_default_value>::batch changes;
+        changes.insert_or_assign(1, no_default_value(10));
+        changes.insert_or_assign(2, no_default_value(20));
+        changes.erase(1);
+        d.apply(changes);
+
+        auto reader = d.make_reader();
+        CHECK(!reader.contains(1));
+        CHECK(reader.visit(2, [](const std::pair<const int, no_default_value>&
+                                     element) {
+            CHECK(element.second.value == 20);
+        }));
+    }
+
+    SECTION("nested reads") {
+        io::read_mostly_dict<int, int> d;
+        d.insert_or_assign(1, 1);
+        auto reader = d.make_reader();
+
+        std::future<void> writer;
+        reader.read([&](const io::dict<int, int>& copy) {
+            // the inner read must not end the outer one
+            CHECK(reader.contains(1));
+            writer = std::async(std::launch::async,
+                                [&d] { d.insert_or_assign(1, 2); });
+            CHECK(writer.wait_for(std::chrono::milliseconds(50)) ==
+                  std::future_status::timeout);
+            CHECK(copy.at(1) == 1);
+            return 0;
+        });
+        writer.get();
+
+        int value = 0;
+        CHECK(reader.find(1, value));
+        CHECK(value == 2);
+    }
+
+    SECTION("multi threaded") {
+        io::read_mostly_dict<int, int> d;
+        const int readers = 4;
+        const int rounds = 200;
+        std::atomic<bool> done(false);
+
+        // every batch keeps key and -key equal, readers must never see
+        // one without the other
+        std::vector<std::future<int>> workers;
+        for (int thread = 0; thread != readers; ++thread) {
+            using reader_type = io::read_mostly_dict<int, int>::reader;
+            auto reader = std::make_shared<reader_type>(d.make_reader());
+            workers.push_back(std::async(std::launch::async, [reader, &done] {
+                int torn = 0;
+                while (!done.load()) {
+                    torn += reader->read([](const io::dict<int, int>& copy) {
+                        int count = 0;
+                        for (const auto& element : copy) {
+                            auto other = copy.find(-element.first);
+                            count += other == copy.end() ||
+                                     other->second != element.second;
+                        }
+                        return count;
+                    });
+                }
+                return torn;
+            }));
+        }
+
+        for (int round = 1; round <= rounds; ++round) {
+            io::read_mostly_dict<int, int>::batch changes;
+            changes.insert_or_assign(round, round);
+            changes.insert_or_assign(-round, round);
+            changes.insert_or_assign(1, round);
+            changes.insert_or_assign(-1, round);
+            if (round % 3 == 0) {
+                changes.erase(round - 1);
+                changes.erase(1 - round);
+            }
+            d.apply(changes);
+        }
+        done.store(true);
+
+        int torn = 0;
+        for (auto& worker : workers) {
+            torn += worker.get();
+        }
+        CHECK(torn == 0);
+
+        auto reader = d.make_reader();
+        int value = 0;
+        CHECK(reader.find(-1, value));
+        CHECK(value == rounds);
+        CHECK(reader.contains(rounds));
+        // erased in round 198
+        CHECK(!reader.contains(197));
+    }
+}
+
+TEST_CASE("frozen dict", "[frozen_dict]") {
+    SECTION("from dict") {
+        io::dict<int, int> source;
+        for (int i = 0; i != 10000; ++i) {
+            source[i * 7] = i;
+        }
+
+        io::frozen_dict<int, int> frozen(source);
+        CHECK(frozen.size() == source.size());
+        CHECK(std::distance(frozen.begin(), frozen.end()) == 10000);
+
+        int mismatches = 0;
+        for (int i = 0; i != 70000; ++i) {
+            auto iter = frozen.find(i);
+            if (i % 7) {
+                mismatches += iter != frozen.end();
+            } else {
+                mismatches += iter == frozen.end() || iter->first != i ||
+                              iter->second != i / 7;
+            }
+        }
+        CHECK(mismatches == 0);
+
+        CHECK(frozen.at(70) == 10);
+        CHECK_THROWS_AS(frozen.at(71), std::out_of_range);
+        CHECK(frozen.count(7) == 1);
+        CHECK(frozen.count(8) == 0);
+        auto range = frozen.equal_range(14);
+        CHECK(std::distance(range.first, range.second) == 1);
+    }
+
+    SECTION("from range") {
+        io::frozen_dict<std::string, int> frozen{ { "Germany", 4 },
+                                                  { "Brazil", 5 },
+                                                  { "France", 2 },
+                                                  { "Germany", 3 } };
+        CHECK(frozen.size() == 3);
+        CHECK(frozen.at("Germany") == 4);
+        CHECK(frozen.at("France") == 2);
+        CHECK(frozen.find("Italy") == frozen.end());
+    }
+
+    SECTION("empty") {
+        io::frozen_dict<int, int> frozen;
+        CHECK(frozen.empty());
+        CHECK(frozen.find(1) == frozen.end());
+        CHECK(frozen.begin() == frozen.end());
+    }
+
+    SECTION("equal hashes") {
+        io::dict<int, int, fake_hasher> source;
+        source[1] = 1;
+        source[2] = 2;
+        CHECK_THROWS_AS((io::frozen_dict<int, int, fake_hasher>(source)),
+                        std::invalid_argument);
+    }
+}
+
+struct mapped_record {
+    int count;
+    double weight;
+};
+
+#if __cpp_constexpr >= 201304 && __cpp_lib_integer_sequence
+// a duplicate key or a failed seed search would fail to compile
+static constexpr auto keywords = io::make_static_dict<io::static_string, int>(
+    { { "if", 1 }, { "else", 2 }, { "while", 3 }, { "for", 4 },
+      { "return", 5 }, { "break", 6 }, { "continue", 7 }, { "switch", 8 },
+      { "case", 9 }, { "default", 10 } });
+
+static_assert(keywords.size() == 10, "static dict size");
+static_assert(keywords.at("while") == 3, "static dict lookup");
+static_assert(!keywords.contains("goto"), "static dict miss");
+static_assert(!keywords.contains(""), "static dict empty key");
+
+TEST_CASE("static dict", "[static_dict]") {
+    SECTION("runtime lookups") {
+        CHECK(keywords.at(std::string("continue")) == 7);
+        CHECK(keywords.count(std::string("contin")) == 0);
+        CHECK(keywords.find("goto") == keywords.end());
+        CHECK_THROWS_AS(keywords.at("goto"), std::out_of_range);
+
+        // in the order given
+        int expected = 1;
+        for (const auto& keyword : keywords) {
+            CHECK(keyword.second == expected++);
+            CHECK(keywords.find(keyword.first) == &keyword);
+        }
+    }
+
+    SECTION("integer keys") {
+        constexpr auto squares = io::make_static_dict<int, int>(
+            { { 1, 1 }, { 2, 4 }, { 3, 9 }, { 4, 16 }, { 5, 25 },
+              { 0, 0 }, { -1, 1 } });
+        static_assert(squares.at(-1) == 1, "static dict integer lookup");
+
+        int mismatches = 0;
+        for (int i = -10; i != 10; ++i) {
+            auto iter = squares.find(i);
+            mismatches += (iter != squares.end()) != (i >= -1 && i <= 5);
+            mismatches += iter != squares.end() && iter->second != i * i;
+        }
+        CHECK(mismatches == 0);
+    }
+}
+#endif
+
+template <typename Storage>
+void check_mapped_dict() {
+    const std::string path = "dict_test_mapped.bin";
+    storage_dict<std::uint64_t, mapped_record, Storage> d;
+    for (std::uint64_t i = 0; i != 5000; ++i) {
+        d[i * 3] = mapped_record{ int(i), i * 0.5 };
+    }
+    d.erase(9);
+    io::write_mapped_dict(d, path);
+
+    {
+        io::mapped_dict<std::uint64_t, mapped_record,
+                        std::hash<std::uint64_t>,
+                        std::equal_to<std::uint64_t>, Storage>
+            mapped(path);
+        CHECK(mapped.size() == d.size());
+        CHECK(std::distance(mapped.begin(), mapped.end()) ==
+              std::ptrdiff_t(d.size()));
+
+        int mismatches = 0;
+        for (std::uint64_t key = 0; key != 15000; ++key) {
+            auto iter = mapped.find(key);
+            auto expected = d.find(key);
+            if (expected == d.end()) {
+                mismatches += iter != mapped.end();
+            } else {
+                mismatches += iter == mapped.end() ||
+                              iter->second.count != expected->second.count ||
+                              iter->second.weight != expected->second.weight;
+            }
+        }
+        CHECK(mismatches == 0);
+
+        CHECK(mapped.count(9) == 0);
+        CHECK(mapped.at(12).count == 4);
+        CHECK_THROWS_AS(mapped.at(13), std::out_of_range);
+    }
+
+    std::remove(path.c_str());
+
+    // free slots are written as the table leaves them after resize, without
+    // whatever an erased entry left there
+    const std::uint64_t secret = 0x5ec2e75ec2e75ec2;
+    storage_dict<std::uint64_t, std::uint64_t, Storage> erased;
+    erased[1] = secret;
+    erased[2] = 2;
+    erased.erase(1);
+    io::write_mapped_dict(erased, path);
+
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    in.close();
+    CHECK(bytes.find(std::string(reinterpret_cast<const char*>(&secret),
+                                 sizeof(secret))) == std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("mapped dict", "[mapped_dict]") {
+    SECTION("flag storage") {
+        check_mapped_dict<io::inline_flag_storage>();
+    }
+
+    SECTION("control byte storage") {
+        check_mapped_dict<io::control_byte_storage>();
+    }
+
+    SECTION("bitmap storage") {
+        check_mapped_dict<io::bitmap_storage>();
+    }
+
+    SECTION("robin hood storage") {
+        check_mapped_dict<io::robin_hood_storage>();
+    }
+
+    SECTION("sentinel storage") {
+        check_mapped_dict<io::sentinel_storage<
+            io::empty_key<std::uint64_t, ~std::uint64_t(0)>>>();
+    }
+
+    SECTION("mismatches") {
+        const std::string path = "dict_test_mapped.bin";
+        io::dict<int, int> d;
+        for (int i = 0; i != 100; ++i) {
+            d[i] = i;
+        }
+        io::write_mapped_dict(d, path);
+
+        using wrong_storage =
+            io::mapped_dict<int, int, std::hash<int>, std::equal_to<int>,
+                            io::robin_hood_storage>;
+        CHECK_THROWS_AS(wrong_storage(path), std::runtime_error);
+        CHECK_THROWS_AS((io::mapped_dict<int, long>(path)),
+                        std::runtime_error);
+        CHECK_THROWS_AS((io::mapped_dict<int, int, fake_hasher>(path)),
+                        std::runtime_error);
+        CHECK_NOTHROW((io::mapped_dict<int, int>(path)));
+
+        std::remove(path.c_str());
+        CHECK_THROWS_AS((io::mapped_dict<int, int>(path)), std::system_error);
+
+        d.rehash_step(1);
+        while (!d.rehashing()) {
+            d[int(d.size())] = 0;
+        }
+        CHECK_THROWS_AS(io::write_mapped_dict(d, path), std::logic_error);
+    }
+}
+
+TEST_CASE("small dict", "[small_dict]") {
+    SECTION("stays inline up to N") {
+        io::small_dict<int, std::string, 4> d;
+        CHECK(d.empty());
+        CHECK(d.begin() == d.end());
+        for (int i = 0; i != 4; ++i) {
+            CHECK(d.emplace(i, std::to_string(i)).second);
+        }
+        CHECK(!d.emplace(2, "x").second);
+        CHECK(!d.spilled());
+        CHECK(d.size() == 4);
+        CHECK(d.at(2) == "2");
+        CHECK(d.count(4) == 0);
+        CHECK_THROWS_AS(d.at(4), std::out_of_range);
+        CHECK(std::distance(d.begin(), d.end()) == 4);
+
+        CHECK(d.erase(1) == 1);
+        CHECK(d.erase(1) == 0);
+        CHECK(d.size() == 3);
+        CHECK(d[3] == "3");
+        CHECK(d.find(1) == d.end());
+    }
+
+    SECTION("spills into a dict") {
+        io::small_dict<int, std::string, 4> d{{1, "1"}, {2, "2"}};
+        for (int i = 3; i != 100; ++i) {
+            d[i] = std::to_string(i);
+        }
+        CHECK(d.spilled());
+        CHECK(d.size() == 99);
+
+        int mismatches = 0;
+        for (int i = 1; i != 100; ++i) {
+            mismatches += d.at(i) != std::to_string(i);
+        }
+        CHECK(mismatches == 0);
+
+        d.clear();
+        CHECK(!d.spilled());
+        CHECK(d.empty());
+        d[1] = "1";
+        CHECK(d.size() == 1);
+    }
+
+    SECTION("against unordered_map") {
+        io::small_dict<int, int, 8> d;
+        check_against_unordered_map(d, 10);
+        io::small_dict<int, int, 8> large;
+        check_against_unordered_map(large, 2000);
+        CHECK(large.spilled());
+    }
+
+    SECTION("erase while iterating") {
+        io::small_dict<int, int> d;
+        for (int i = 0; i != 6; ++i) {
+            d[i] = i;
+        }
+        for (auto iter = d.begin(); iter != d.end();) {
+            iter = iter->first % 2 ? d.erase(iter) : std::next(iter);
+        }
+        CHECK(d.size() == 3);
+        CHECK(io::erase_if(d, [](const std::pair<const int, int>& e) {
+                  return e.first == 2;
+              }) == 1);
+        CHECK(d.size() == 2);
+        CHECK(d.count(0) == 1);
+        CHECK(d.count(4) == 1);
+    }
+
+    SECTION("copy, move and swap") {
+        io::small_dict<int, std::string, 2> inline_d{{1, "1"}};
+        io::small_dict<int, std::string, 2> spilled_d{{1, "1"}, {2, "2"},
+                                                      {3, "3"}};
+        REQUIRE(spilled_d.spilled());
+
+        auto inline_copy = inline_d;
+        auto spilled_copy = spilled_d;
+        CHECK(inline_copy == inline_d);
+        CHECK(spilled_copy == spilled_d);
+        CHECK(inline_copy != spilled_copy);
+
+        auto moved = std::move(spilled_copy);
+        CHECK(moved == spilled_d);
+        CHECK(spilled_copy.empty());
+        CHECK(!spilled_copy.spilled());
+
+        swap(inline_copy, moved);
+        CHECK(inline_copy == spilled_d);
+        CHECK(moved == inline_d);
+    }
+
+    SECTION("try_emplace and insert_or_assign") {
+        io::small_dict<int, moved_tester, 2> d;
+        moved_tester value(1);
+        CHECK(d.try_emplace(1, std::move(value)).second);
+        CHECK(value.moved_from);
+
+        moved_tester other(2);
+        CHECK(!d.try_emplace(1, std::move(other)).second);
+        CHECK(!other.moved_from);
+        CHECK(!d.insert_or_assign(1, moved_tester(3)).second);
+        CHECK(d.at(1).var == 3);
+
+        CHECK(d.insert_or_assign(2, moved_tester(4)).second);
+        CHECK(d.insert_or_assign(3, moved_tester(5)).second);
+        CHECK(d.spilled());
+        CHECK(d.at(3).var == 5);
+    }
+}
+
+TEST_CASE("string dict", "[string_dict]") {
+    const std::string long_key = "a key too long to be stored inline";
+    const std::string other_long_key = "a key too long to be stored inlinf";
+
+    SECTION("short and long keys") {
+        io::string_dict<int> d{ { "short", 1 }, { long_key, 2 } };
+        CHECK(d.size() == 2);
+        CHECK(d.at("short") == 1);
+        CHECK(d.at(long_key) == 2);
+        CHECK(d.count(other_long_key) == 0);
+        CHECK(d.count("shorT") == 0);
+        CHECK(d.count("") == 0);
+        CHECK_THROWS_AS(d.at("missing"), std::out_of_range);
+
+        d[""] = 3;
+        d[other_long_key] = 4;
+        CHECK(d.at("") == 3);
+        CHECK(d.at(other_long_key) == 4);
+        CHECK(d.arena_bytes() == 2 * long_key.size());
+
+        std::map<std::string, int> elements;
+        for (const auto& element : d) {
+            elements[element.first.str()] = element.second;
+        }
+        CHECK(elements == (std::map<std::string, int>{
+                              { "", 3 },
+                              { "short", 1 },
+                              { long_key, 2 },
+                              { other_long_key, 4 } }));
+    }
+
+    SECTION("keys are only stored when inserted") {
+        io::string_dict<int> d;
+        CHECK(d.try_emplace(long_key, 1).second);
+        CHECK(!d.try_emplace(long_key, 2).second);
+        CHECK(!d.insert_or_assign(long_key, 3).second);
+        CHECK(d.find(long_key) != d.end());
+        CHECK(d.at(long_key) == 3);
+        CHECK(d.arena_bytes() == long_key.size());
+    }
+
+    SECTION("against unordered_map") {
+        io::string_dict<int> d;
+        std::unordered_map<std::string, int> reference;
+        std::mt19937 engine;
+        std::uniform_int_distribution<int> keys(0, 2000);
+
+        int mismatches = 0;
+        for (int i = 0; i != 20000; ++i) {
+            auto key = std::to_string(keys(engine));
+            key += i % 2 ? key + key + key : "";
+            switch (i % 3) {
+            case 0:
+                d[key] = i;
+                reference[key] = i;
+                break;
+            case 1:
+                mismatches += d.erase(key) != reference.erase(key);
+                break;
+            default:
+                mismatches += d.count(key) != reference.count(key);
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(d.size() == reference.size());
+
+        for (const auto& element : d) {
+            auto iter = reference.find(element.first.str());
+            mismatches += iter == reference.end() ||
+                          iter->second != element.second;
+        }
+        CHECK(mismatches == 0);
+    }
+
+    SECTION("erased keys are compacted") {
+        io::string_dict<int> d;
+        for (int i = 0; i != 1000; ++i) {
+            d[long_key + std::to_string(i)] = i;
+        }
+        for (int i = 0; i != 990; ++i) {
+            d.erase(long_key + std::to_string(i));
+        }
+        CHECK(d.size() == 10);
+        CHECK(d.arena_bytes() < 100 * long_key.size());
+        CHECK(d.at(long_key + "995") == 995);
+    }
+
+    SECTION("copies have their own arena") {
+        io::string_dict<std::string> d{ { long_key, "value" } };
+        auto copy = d;
+        d.clear();
+        CHECK(d.empty());
+        CHECK(d.arena_bytes() == 0);
+        CHECK(copy.at(long_key) == "value");
+        CHECK(copy != d);
+
+        auto moved = std::move(copy);
+        CHECK(moved.at(long_key) == "value");
+        d = moved;
+        CHECK(d == moved);
+    }
+}
+
+TEST_CASE("prehashed keys", "[dict][prehash]") {
+    int hashes = 0;
+    io::dict<int, int, counting_hasher> first(16, counting_hasher{ &hashes });
+    io::dict<int, int, counting_hasher> second(16, counting_hasher{ &hashes });
+
+    const int value = 42;
+    auto key = first.prehash(value);
+    CHECK(hashes == 1);
+    CHECK(key.key() == 42);
+    CHECK(key.hash() == 42);
+
+    first.prefetch(key);
+    CHECK(first.find(key) == first.end());
+
+    first[key] = 1;
+    CHECK(second.try_emplace(key, 2).second == true);
+    CHECK(second.try_emplace(key, 3).second == false);
+    CHECK(first.insert_or_assign(key, 4).second == false);
+
+    const auto& const_second = second;
+    CHECK(first.find(key)->second == 4);
+    CHECK(const_second.find(key)->second == 2);
+
+    CHECK(first.erase(key) == 1);
+    CHECK(first.erase(key) == 0);
+    CHECK(second.erase(key) == 1);
+    CHECK(first.empty());
+    CHECK(second.empty());
+
+    CHECK(hashes == 1);
+}
+
+TEST_CASE("prehashed transparent keys", "[dict][prehash][transparent]") {
+    io::dict<tracked_key, int, tracked_key_hash, tracked_key_equal> d;
+    d[tracked_key("one")] = 1;
+
+    tracked_key::constructions = 0;
+
+    auto one = d.prehash("one");
+    auto two = d.prehash("two");
+    CHECK(d.find(one)->second == 1);
+    CHECK(d.find(two) == d.end());
+    CHECK(tracked_key::constructions == 0);
+
+    d[two] = 2;
+    CHECK(tracked_key::constructions == 1);
+    CHECK(d.at("two") == 2);
+}
+
+template <typename Dict>
+void check_find_batch() {
+    Dict d;
+    for (int i = 0; i < 100; ++i) {
+        d[i * 2] = i;
+    }
+
+    // odd keys miss, more keys than a single batch
+    std::vector<int> keys;
+    for (int i = 0; i < 70; ++i) {
+        keys.push_back(i);
+    }
+
+    std::vector<typename Dict::iterator> found;
+    d.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+    REQUIRE(found.size() == keys.size());
+
+    std::vector<bool> contained(keys.size());
+    auto out = d.contains_batch(keys.begin(), keys.end(), contained.begin());
+    CHECK(out == contained.end());
+
+    const auto& const_d = d;
+    std::vector<typename Dict::const_iterator> const_found(keys.size());
+    const_d.find_batch(keys.begin(), keys.end(), const_found.begin());
+
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        CHECK(found[i] == d.find(keys[i]));
+        CHECK(const_found[i] == const_d.find(keys[i]));
+        CHECK(contained[i] == (keys[i] % 2 == 0));
+    }
+
+    std::vector<int> none;
+    CHECK(d.find_batch(none.begin(), none.end(), found.begin()) ==
+          found.begin());
+}
+
+TEST_CASE("find batch", "[dict][batch]") {
+    check_find_batch<io::dict<int, int>>();
+    check_find_batch<storage_dict<int, int, io::control_byte_storage>>();
+    check_find_batch<storage_dict<int, int, io::bitmap_storage>>();
+    check_find_batch<storage_dict<int, int, io::robin_hood_storage>>();
+}
+
+#ifdef __cpp_deduction_guides
+TEST_CASE("C++17 deduction guides", "[dict][C++17]") {
+    io::dict<int, int> d_with_types{{1,2}, {3,4}};
+    io::dict d_without_types(d_with_types.begin(), d_with_types.end());
+
+    CHECK(d_without_types[1] == 2);
+    CHECK(d_without_types[3] == 4);
+}
+#endif
+
+TEST_CASE("nothrow move constructalbe", "[dict][construct]") {
+    // default ctors
+    static_assert(std::is_default_constructible<io::dict<int, std::string>>::value,
+        "dict should be default constructible");
+    // Need to make dict() not allocate for that
+    // static_assert(std::is_nothrow_default_constructible<io::dict<int, std::string>>::value,
+    //     "dict should be noexcept default constructible");
+
+    // copy ctors
+    static_assert(std::is_copy_constructible<io::dict<int, std::string>>::value,
+        "dict should be copy constructible");
+
+    // move ctors
+    static_assert(std::is_move_constructible<io::dict<int, std::string>>::value,
+        "dict should be move constructible");
+    static_assert(std::is_nothrow_move_constructible<io::dict<int, std::string>>::value,
+        "dict should be noexcept move constructible");
+
+    // copy assignment
+    static_assert(std::is_copy_assignable<io::dict<int, std::string>>::value,
+        "dict should be copy assignable");
+
+    // move assignment
+    static_assert(std::is_move_assignable<io::dict<int, std::string>>::value,
+        "dict should be move assignable");
+    static_assert(std::is_nothrow_move_assignable<io::dict<int, std::string>>::value,
+        "dict should be noexcept move assignable");
+
+#ifdef __cpp_lib_is_swappable
+    // swapability
+    static_assert(std::is_swappable<io::dict<int, std::string>>::value,
+        "dict should be swappable");
+    // need to figure this out
+    // static_assert(std::is_nothrow_swappable<io::dict<int, std::string>>::value,
+    //     "dict should be noexcept swappable");
+#endif
+}
+
+#if __cpp_lib_memory_resource
+// remembers the blocks it handed out, giving it one it doesn't know is what
+// mixing up the resources of two containers looks like
+class tracking_resource : public std::pmr::memory_resource {
+public:
+    std::size_t live() const { return _blocks.size(); }
+
+    int foreign = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto block =
+            std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        _blocks.insert(block);
+        return block;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes,
+                       std::size_t alignment) override {
+        foreign += _blocks.erase(p) == 0;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const
+        noexcept override {
+        return this == &other;
+    }
+
+    std::set<void*> _blocks;
+};
+
+// polymorphic allocators don't propagate, a dict assigned to keeps its
+// resource and gets the elements copied or moved over
+template <typename Storage, typename Value>
+void check_pmr_assignment(const Value& value) {
+    using pmr_dict = io::pmr::dict<int, Value, std::hash<int>,
+                                   std::equal_to<int>, Storage>;
+    tracking_resource first;
+    tracking_resource second;
+    {
+        pmr_dict a(&first);
+        pmr_dict b(&second);
+        for (int i = 0; i != 100; ++i) {
+            a[i] = value;
+        }
+        b[-1] = value;
+
+        b = a;
+        CHECK(b.get_allocator().resource() == &second);
+        CHECK(b.size() == 100);
+        CHECK(b.count(-1) == 0);
+        CHECK(b.at(42) == value);
+
+        pmr_dict c(&second);
+        c[-1] = value;
+        c = std::move(a);
+        CHECK(c.get_allocator().resource() == &second);
+        CHECK(c.size() == 100);
+        CHECK(c.at(42) == value);
+
+        pmr_dict d(&second);
+        d = std::move(c);
+        CHECK(d.size() == 100);
+        CHECK(d.at(42) == value);
+    }
+    CHECK(first.foreign == 0);
+    CHECK(second.foreign == 0);
+    CHECK(first.live() == 0);
+    CHECK(second.live() == 0);
+}
+
+TEST_CASE("pmr support", "[dict][pmr]") {
+    auto allocator = std::pmr::new_delete_resource();
+    io::pmr::dict<int, int> pmr_dict(allocator);
+
+    pmr_dict[1] = 2;
+
+    CHECK(pmr_dict[1] == 2);
+    CHECK(pmr_dict.get_allocator().resource() == allocator);
+
+    SECTION("monotonic arena") {
+        char buffer[1 << 16];
+        std::pmr::monotonic_buffer_resource arena(
+            buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        io::pmr::dict<int, std::pmr::string> d(&arena);
+
+        for (int i = 0; i != 100; ++i) {
+            d[i] = "value";
+        }
+
+        CHECK(d.size() == 100);
+        CHECK(d.at(42) == "value");
+    }
+
+    SECTION("recycling resource") {
+        char buffer[1 << 14];
+        std::pmr::monotonic_buffer_resource arena(
+            buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        io::pmr::recycling_resource recycler(&arena);
+
+        CHECK(recycler.upstream_resource() == &arena);
+
+        auto block = recycler.allocate(64, 8);
+        recycler.deallocate(block, 64, 8);
+        CHECK(recycler.allocate(64, 8) == block);
+        CHECK(recycler.allocate(64, 8) != block);
+        CHECK(recycler.allocate(32, 8) != block);
+
+        // without recycling the outgrown tables of all dicts would overflow
+        // the arena, which has no upstream
+        for (int round = 0; round != 20; ++round) {
+            io::pmr::dict<int, int> d(&recycler);
+            for (int i = 0; i != 200; ++i) {
+                d[i] = i;
+            }
+            CHECK(d.size() == 200);
+        }
+    }
+
+    SECTION("assignment between resources") {
+        const std::string value = "a string too long for the small buffer";
+        check_pmr_assignment<io::inline_flag_storage>(value);
+        check_pmr_assignment<io::inline_flag_storage>(7);
+        check_pmr_assignment<io::control_byte_storage>(value);
+        check_pmr_assignment<io::control_byte_storage>(7);
+        check_pmr_assignment<io::bitmap_storage>(value);
+        check_pmr_assignment<io::bitmap_storage>(7);
+        check_pmr_assignment<io::robin_hood_storage>(value);
+        check_pmr_assignment<io::robin_hood_storage>(7);
+        check_pmr_assignment<int_sentinel_storage>(value);
+        check_pmr_assignment<int_sentinel_storage>(7);
+        check_pmr_assignment<io::node_storage>(value);
+    }
+
+    SECTION("string dict") {
+        using pmr_string_dict = io::string_dict<
+            int, std::pmr::polymorphic_allocator<
+                     std::pair<const io::string_key, int>>>;
+        const std::string long_key = "a key too long to be stored inline";
+        tracking_resource first;
+        tracking_resource second;
+        {
+            pmr_string_dict d(&first);
+            for (int i = 0; i != 2000; ++i) {
+                d[long_key + std::to_string(i)] = i;
+            }
+
+            // erasing compacts the arena several times
+            for (int i = 0; i != 1990; ++i) {
+                d.erase(long_key + std::to_string(i));
+            }
+            CHECK(d.size() == 10);
+            CHECK(d.arena_bytes() < 100 * long_key.size());
+            CHECK(d.at(long_key + "1995") == 1995);
+            CHECK(d.get_allocator().resource() == &first);
+
+            pmr_string_dict copy(&second);
+            copy = d;
+            CHECK(copy.get_allocator().resource() == &second);
+            CHECK(copy == d);
+        }
+        CHECK(first.foreign == 0);
+        CHECK(second.foreign == 0);
+        CHECK(first.live() == 0);
+        CHECK(second.live() == 0);
+    }
 }
 #endif